@@ -0,0 +1,74 @@
+/*
+  ActionQueue.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ActionQueue.h"
+
+///////////////////////////////////////////////////////////////////////////
+// ActionQueue
+///////////////////////////////////////////////////////////////////////////
+
+ActionQueue::ActionQueue()
+: _count(0)
+{
+}
+
+bool ActionQueue::post(PropertyAction *action)
+{
+	assert(action != NULL);
+	if (_count == MAX_ACTIONS) {
+		return false;
+	}
+	_actions[_count++] = action;
+	return true;
+}
+
+void ActionQueue::cancel(PropertyAction *action)
+{
+	for (uint8_t i = 0; i < _count; ++i) {
+		if (_actions[i] == action) {
+			action->requestCancel();
+			// a running action gets a last step to clean up
+			if (!action->isBusy()) {
+				remove(i);
+			}
+			return;
+		}
+	}
+}
+
+bool ActionQueue::runStep()
+{
+	if (_count == 0) {
+		return false;
+	}
+	if (_actions[0]->runStep()) {
+		remove(0);
+	}
+	return true;
+}
+
+void ActionQueue::remove(uint8_t idx)
+{
+	assert(idx < _count);
+	_count--;
+	for (uint8_t i = idx; i < _count; ++i) {
+		_actions[i] = _actions[i + 1];
+	}
+}
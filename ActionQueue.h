@@ -0,0 +1,52 @@
+/*
+  ActionQueue.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ACTION_QUEUE_H_
+#define ACTION_QUEUE_H_
+
+#include "PropertyMenu.h"
+
+///////////////////////////////////////////////////////////////////////////
+// ActionQueue
+///////////////////////////////////////////////////////////////////////////
+
+// Confirmed PropertyActions waiting to run. The main loop calls runStep()
+// after input has been handled and painted, so a long action never holds
+// the old frame on screen and can be cancelled between two slices.
+class ActionQueue
+{
+public:
+	enum {
+		MAX_ACTIONS = 4
+	};
+	ActionQueue();
+	bool post(PropertyAction *action); // false if full
+	void cancel(PropertyAction *action);
+	bool isIdle() const { return _count == 0; }
+	bool runStep(); // one slice of the oldest action, false if idle
+
+private:
+	void remove(uint8_t idx);
+
+	PropertyAction *_actions[MAX_ACTIONS];
+	uint8_t _count;
+};
+
+#endif // ACTION_QUEUE_H_
@@ -0,0 +1,211 @@
+/*
+  ButtonInput.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ButtonInput.h"
+#include "MenuTrace.h"
+
+// Page::buttonInput() counted by the screen and traced, the first of a
+// dispatch also opening the input scope
+static uint8_t pageInput(Page *page, ButtonPress button, Screen *screen, bool *inInput)
+{
+	if (!*inInput) {
+		*inInput = true;
+		TRACE_BEGIN(SCOPE_INPUT, button);
+	}
+	screen->countEvent();
+	TRACE_BEGIN(SCOPE_BUTTON_INPUT, button);
+	uint8_t line = page->buttonInput(button, screen);
+	TRACE_END(SCOPE_BUTTON_INPUT);
+	return line;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// ButtonRepeater
+///////////////////////////////////////////////////////////////////////////
+
+ButtonRepeater::ButtonRepeater()
+: _pressTime(0),
+	_nextEvent(0),
+	_interval(REPEAT_INTERVAL_START),
+	_held(BUTTON_PRESS_NONE),
+	_pending(BUTTON_PRESS_NONE)
+{
+}
+
+void ButtonRepeater::press(ButtonPress button, uint32_t now)
+{
+	assert(BUTTON_PRESS_DOWN <= button && button <= BUTTON_PRESS_ENTER);
+	_held = button;
+	_pending = button;
+	_pressTime = now;
+	_interval = REPEAT_INTERVAL_START;
+	_nextEvent = now + (button == BUTTON_PRESS_ENTER ? LONG_PRESS_DELAY : REPEAT_DELAY);
+}
+
+void ButtonRepeater::release(ButtonPress button, uint32_t /*now*/)
+{
+	// the press is still delivered if it was not polled yet
+	if (button == _held) {
+		_held = BUTTON_PRESS_NONE;
+	}
+}
+
+ButtonPress ButtonRepeater::poll(uint32_t now)
+{
+	if (_pending != BUTTON_PRESS_NONE) {
+		ButtonPress b = static_cast<ButtonPress>(_pending);
+		_pending = BUTTON_PRESS_NONE;
+		return b;
+	}
+	if (_held == BUTTON_PRESS_NONE || !timeReached(now, _nextEvent)) {
+		return BUTTON_PRESS_NONE;
+	}
+	switch (_held) {
+		case BUTTON_PRESS_ENTER:
+			_held = BUTTON_PRESS_NONE; // long press fires once
+			return BUTTON_PRESS_HOLD_ENTER;
+		case BUTTON_PRESS_DOWN:
+		case BUTTON_PRESS_UP:
+			// after a stall catch up by a few repeats only, not by all of them
+			if (timeReached(now, _nextEvent + REPEAT_DELAY)) {
+				_nextEvent = now;
+			}
+			_nextEvent += _interval;
+			_interval -= _interval / 4;
+			if (_interval < REPEAT_INTERVAL_MIN) {
+				_interval = REPEAT_INTERVAL_MIN;
+			}
+			return _held == BUTTON_PRESS_DOWN ? BUTTON_PRESS_HOLD_DOWN : BUTTON_PRESS_HOLD_UP;
+		default:
+			return BUTTON_PRESS_NONE;
+	}
+}
+
+uint32_t ButtonRepeater::getHoldTime(uint32_t now) const
+{
+	return isHeld() ? now - _pressTime : 0;
+}
+
+uint8_t ButtonRepeater::dispatch(Page *page, Screen *screen, uint32_t now)
+{
+	ButtonDispatcher dispatcher(NULL, this);
+	uint8_t line = dispatcher.dispatch(page, screen, now);
+	dispatcher.endInput();
+	return line;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// ButtonEventQueue
+///////////////////////////////////////////////////////////////////////////
+
+ButtonEventQueue::ButtonEventQueue()
+: _head(0),
+	_tail(0),
+	_dropped(0)
+{
+}
+
+bool ButtonEventQueue::push(ButtonPress button, bool released, uint32_t time)
+{
+	uint8_t head = _head;
+	if (static_cast<uint8_t>(head - _tail) >= CAPACITY) {
+		if (_dropped < 0xff) {
+			_dropped++;
+		}
+		return false;
+	}
+	ButtonEvent &e = _events[head & (CAPACITY - 1)];
+	e.time = time;
+	e.button = button;
+	e.released = released;
+	BUTTON_QUEUE_BARRIER();
+	_head = head + 1;
+	return true;
+}
+
+bool ButtonEventQueue::pop(ButtonEvent *event)
+{
+	assert(event != NULL);
+	uint8_t tail = _tail;
+	if (tail == _head) {
+		return false;
+	}
+	BUTTON_QUEUE_BARRIER();
+	*event = _events[tail & (CAPACITY - 1)];
+	BUTTON_QUEUE_BARRIER();
+	_tail = tail + 1;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// ButtonDispatcher
+///////////////////////////////////////////////////////////////////////////
+
+ButtonDispatcher::ButtonDispatcher(ButtonEventQueue *queue, ButtonRepeater *repeater)
+: _queue(queue),
+	_repeater(repeater),
+	_inputOpen(false)
+{
+	assert(queue != NULL || repeater != NULL);
+}
+
+uint8_t ButtonDispatcher::dispatch(Page *page, Screen *screen, uint32_t now)
+{
+	assert(page != NULL);
+	assert(screen != NULL);
+	endInput();
+	uint8_t line = Page::INVALID_LINE;
+	bool inInput = false;
+	screen->beginUpdate();
+	ButtonEvent e;
+	while (line == Page::INVALID_LINE && _queue != NULL && _queue->pop(&e)) {
+		ButtonPress button = static_cast<ButtonPress>(e.button);
+		if (_repeater == NULL) {
+			if (!e.released) {
+				line = pageInput(page, button, screen, &inInput);
+			}
+		} else if (e.released) {
+			_repeater->release(button, e.time);
+		} else {
+			_repeater->press(button, e.time);
+			line = pageInput(page, _repeater->poll(e.time), screen, &inInput);
+		}
+	}
+	while (_repeater != NULL && line == Page::INVALID_LINE) {
+		ButtonPress b = _repeater->poll(now);
+		if (b == BUTTON_PRESS_NONE) {
+			break;
+		}
+		line = pageInput(page, b, screen, &inInput);
+	}
+	if (screen->endUpdate()) {
+		page->paint(screen);
+	}
+	_inputOpen = _inputOpen || inInput;
+	return line;
+}
+
+void ButtonDispatcher::endInput()
+{
+	if (_inputOpen) {
+		_inputOpen = false;
+		TRACE_END(SCOPE_INPUT);
+	}
+}
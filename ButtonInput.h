@@ -0,0 +1,134 @@
+/*
+  ButtonInput.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef BUTTON_INPUT_H_
+#define BUTTON_INPUT_H_
+
+#include "PropertyMenu.h"
+
+// Orders the event slot write before the index update that publishes it.
+// A compiler barrier is enough on AVR, where only an ISR interleaves with
+// loop(). Threads on a host also need a hardware fence: _ReadWriteBarrier()
+// alone only stops the compiler.
+#if defined(__AVR__)
+#define BUTTON_QUEUE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#include <emmintrin.h>
+#define BUTTON_QUEUE_BARRIER() do { _ReadWriteBarrier(); _mm_mfence(); _ReadWriteBarrier(); } while (0)
+#else
+#define BUTTON_QUEUE_BARRIER() __sync_synchronize()
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// ButtonRepeater
+///////////////////////////////////////////////////////////////////////////
+
+// Turns timestamped press/release edges into the events delivered to
+// Page::buttonInput: the press itself, then BUTTON_PRESS_HOLD_DOWN/UP at an
+// accelerating rate while the button stays down, or a single
+// BUTTON_PRESS_HOLD_ENTER for a long press of ENTER. Times are in ms.
+class ButtonRepeater
+{
+public:
+	enum {
+		REPEAT_DELAY = 400, // before the first repeat
+		REPEAT_INTERVAL_START = 200,
+		REPEAT_INTERVAL_MIN = 40,
+		LONG_PRESS_DELAY = 800
+	};
+	ButtonRepeater();
+	void press(ButtonPress button, uint32_t now);
+	void release(ButtonPress button, uint32_t now);
+	ButtonPress poll(uint32_t now); // BUTTON_PRESS_NONE when nothing is due
+	bool isHeld() const { return _held != BUTTON_PRESS_NONE; }
+	bool hasPending() const { return _pending != BUTTON_PRESS_NONE; }
+	uint32_t getNextDeadline() const { return _nextEvent; } // meaningful if isHeld()
+	uint32_t getHoldTime(uint32_t now) const;
+	// feeds all due events to the page through a ButtonDispatcher without
+	// queue, for buttons that call press() and release() directly
+	uint8_t dispatch(Page *page, Screen *screen, uint32_t now);
+
+private:
+	uint32_t _pressTime;
+	uint32_t _nextEvent;
+	uint16_t _interval;
+	int8_t _held;
+	int8_t _pending;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// ButtonEventQueue
+///////////////////////////////////////////////////////////////////////////
+
+struct ButtonEvent {
+	uint32_t time;
+	int8_t button; // ButtonPress
+	bool released;
+};
+
+// Lock-free single-producer/single-consumer ring: push() from the
+// pin-change ISR, pop() from loop(). Each index is written by one side
+// only and fits a byte, so updates are atomic on every target.
+class ButtonEventQueue
+{
+public:
+	enum {
+		CAPACITY = 16 // power of two, at most 128
+	};
+	ButtonEventQueue();
+	bool push(ButtonPress button, bool released, uint32_t time); // false if full
+	bool pop(ButtonEvent *event);
+	bool isEmpty() const { return _head == _tail; }
+	uint8_t getDropped() const { return _dropped; }
+
+private:
+	ButtonEvent _events[CAPACITY];
+	volatile uint8_t _head;
+	volatile uint8_t _tail;
+	volatile uint8_t _dropped;
+};
+
+
+///////////////////////////////////////////////////////////////////////////
+// ButtonDispatcher
+///////////////////////////////////////////////////////////////////////////
+
+// Drains a ButtonEventQueue into the current page, painting at most once.
+// With a ButtonRepeater the queued edges also produce auto-repeat and long
+// press events; the queue may then be NULL.
+class ButtonDispatcher
+{
+public:
+	ButtonDispatcher(ButtonEventQueue *queue, ButtonRepeater *repeater);
+	// stops at the first result other than INVALID_LINE so that the
+	// remaining events go to the page the caller switches to
+	uint8_t dispatch(Page *page, Screen *screen, uint32_t now);
+	// the result of the last dispatch is on screen: page change, refresh
+	// and poll done; closes the input scope of the trace
+	void endInput();
+
+private:
+	ButtonEventQueue *_queue;
+	ButtonRepeater *_repeater;
+	bool _inputOpen;
+};
+
+#endif // BUTTON_INPUT_H_
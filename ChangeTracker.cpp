@@ -0,0 +1,76 @@
+/*
+  ChangeTracker.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ChangeTracker.h"
+
+///////////////////////////////////////////////////////////////////////////
+// ChangeTracker
+///////////////////////////////////////////////////////////////////////////
+
+ChangeTracker::ChangeTracker(Property **storage, uint8_t capacity, ChangeCallback callback)
+: _changed(storage),
+	_capacity(capacity),
+	_count(0),
+	_overflowed(false),
+	_flushOnExit(true),
+	_callback(callback)
+{
+	assert(storage != NULL);
+	assert(capacity > 0);
+}
+
+Property *ChangeTracker::getChanged(uint8_t idx) const
+{
+	assert(idx < _count);
+	return _changed[idx];
+}
+
+bool ChangeTracker::markChanged(Property *property)
+{
+	assert(property != NULL);
+	if (_count < _capacity) {
+		_changed[_count++] = property;
+		return true;
+	}
+	_overflowed = true;
+	return false;
+}
+
+void ChangeTracker::exitEdit()
+{
+	if (_flushOnExit) {
+		flush();
+	}
+}
+
+void ChangeTracker::flush()
+{
+	if (!isPending()) {
+		return;
+	}
+	if (_callback != NULL) {
+		_callback(_changed, _count, _overflowed);
+	}
+	for (uint8_t i = 0; i < _count; ++i) {
+		_changed[i]->clearDirty();
+	}
+	_count = 0;
+	_overflowed = false;
+}
@@ -0,0 +1,61 @@
+/*
+  ChangeTracker.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CHANGE_TRACKER_H_
+#define CHANGE_TRACKER_H_
+
+#include "PropertyMenu.h"
+
+///////////////////////////////////////////////////////////////////////////
+// ChangeTracker
+///////////////////////////////////////////////////////////////////////////
+
+// Collects the properties edited since the last flush(), so consumers
+// react in O(changed) instead of diffing all their settings. A property
+// is appended once, when its dirty bit goes up; flush() hands the whole
+// batch to the callback and clears the bits. Flush on exit from editing,
+// or from a periodic task for a per tick batch.
+class ChangeTracker
+{
+public:
+	// overflowed is true when more properties changed than fit the list:
+	// changed[] is then incomplete and the consumer must rescan. Properties
+	// left out are not marked dirty, so their next change is reported again.
+	typedef void (*ChangeCallback)(Property **changed, uint8_t count, bool overflowed);
+
+	ChangeTracker(Property **storage, uint8_t capacity, ChangeCallback callback);
+	void setFlushOnExit(bool flushOnExit) { _flushOnExit = flushOnExit; }
+	uint8_t getCount() const { return _count; }
+	Property *getChanged(uint8_t idx) const;
+	bool isPending() const { return _count > 0 || _overflowed; }
+	bool markChanged(Property *property); // called by Property, false if not listed
+	void exitEdit(); // called by PropertyPage when editing ends, flushes if enabled
+	void flush();
+
+private:
+	Property **_changed;
+	uint8_t _capacity;
+	uint8_t _count;
+	bool _overflowed;
+	bool _flushOnExit;
+	ChangeCallback _callback;
+};
+
+#endif // CHANGE_TRACKER_H_
@@ -0,0 +1,123 @@
+/*
+  FrameCache.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "FrameCache.h"
+
+///////////////////////////////////////////////////////////////////////////
+// FrameCache
+///////////////////////////////////////////////////////////////////////////
+
+FrameCache::FrameCache(ShadowLCD *shadow, char *storage, uint16_t storageSize)
+: _shadow(shadow),
+	_storage(storage),
+	_storageSize(storageSize)
+{
+	assert(shadow != NULL);
+	assert(storage != NULL);
+	clear();
+}
+
+uint8_t FrameCache::getSlotCount() const
+{
+	uint16_t frameSize = _shadow->getFrameSize();
+	if (frameSize == 0) {
+		return 0;
+	}
+	uint16_t n = _storageSize / frameSize;
+	if (n > MAX_SLOTS) {
+		n = MAX_SLOTS;
+	}
+	return static_cast<uint8_t>(n);
+}
+
+char *FrameCache::getSlotFrame(uint8_t slot) const
+{
+	return _storage + slot * _shadow->getFrameSize();
+}
+
+void FrameCache::store(const Page *page)
+{
+	assert(page != NULL);
+	uint8_t count = getSlotCount();
+	uint16_t hash = page->getContentHash();
+	if (count == 0 || hash == Page::CONTENT_UNCACHEABLE) {
+		invalidate(page);
+		return;
+	}
+	// same page first, then an empty slot, then the least recently stored
+	uint8_t victim = 0;
+	for (uint8_t i = 0; i < count; ++i) {
+		if (_slots[i].page == page) {
+			victim = i;
+			break;
+		}
+		if (_slots[victim].page != NULL &&
+			(_slots[i].page == NULL || _slots[i].age > _slots[victim].age)) {
+			victim = i;
+		}
+	}
+	for (uint8_t i = 0; i < count; ++i) {
+		if (_slots[i].age < 0xff) {
+			_slots[i].age++;
+		}
+	}
+	Slot &s = _slots[victim];
+	s.page = page;
+	s.state = page->getState();
+	s.hash = hash;
+	s.age = 0;
+	memcpy(getSlotFrame(victim), _shadow->getFrame(), _shadow->getFrameSize());
+}
+
+bool FrameCache::restore(const Page *page)
+{
+	assert(page != NULL);
+	uint8_t count = getSlotCount();
+	for (uint8_t i = 0; i < count; ++i) {
+		Slot &s = _slots[i];
+		if (s.page != page) {
+			continue;
+		}
+		if (s.state != page->getState() || s.hash != page->getContentHash()) {
+			s.page = NULL;
+			return false;
+		}
+		_shadow->blit(getSlotFrame(i));
+		return true;
+	}
+	return false;
+}
+
+void FrameCache::invalidate(const Page *page)
+{
+	for (uint8_t i = 0; i < MAX_SLOTS; ++i) {
+		if (_slots[i].page == page) {
+			_slots[i].page = NULL;
+		}
+	}
+}
+
+void FrameCache::clear()
+{
+	for (uint8_t i = 0; i < MAX_SLOTS; ++i) {
+		_slots[i].page = NULL;
+		_slots[i].age = 0;
+	}
+}
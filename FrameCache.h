@@ -0,0 +1,64 @@
+/*
+  FrameCache.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef FRAME_CACHE_H_
+#define FRAME_CACHE_H_
+
+#include "PropertyMenu.h"
+#include "ShadowLCD.h"
+
+///////////////////////////////////////////////////////////////////////////
+// FrameCache
+///////////////////////////////////////////////////////////////////////////
+
+// Last rendered frames of recently left pages, keyed by page and scroll
+// state. A frame is only reused while Page::getContentHash() is unchanged,
+// so values edited in the meantime force a normal repaint; pages that
+// return Page::CONTENT_UNCACHEABLE are never kept.
+class FrameCache
+{
+public:
+	enum {
+		MAX_SLOTS = 4
+	};
+	// storage is split in frames of the shadow display size
+	FrameCache(ShadowLCD *shadow, char *storage, uint16_t storageSize);
+	void store(const Page *page); // saves what the display shows now
+	bool restore(const Page *page); // false if no valid frame, page must be painted
+	void invalidate(const Page *page);
+	void clear();
+
+private:
+	struct Slot {
+		const Page *page;
+		uint16_t state;
+		uint16_t hash;
+		uint8_t age;
+	};
+	uint8_t getSlotCount() const;
+	char *getSlotFrame(uint8_t slot) const;
+
+	ShadowLCD *_shadow;
+	char *_storage;
+	uint16_t _storageSize;
+	Slot _slots[MAX_SLOTS];
+};
+
+#endif // FRAME_CACHE_H_
@@ -0,0 +1,91 @@
+/*
+  MenuFootprint.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "MenuFootprint.h"
+#include "ChangeTracker.h"
+#include "ActionQueue.h"
+
+static void printRow(Print *out, const char *name, uint16_t ram, uint16_t flash)
+{
+	out->print(name);
+	out->print('\t');
+	out->print(ram);
+	out->print('\t');
+	out->print(flash);
+	out->print('\n');
+}
+
+static void printRow(Print *out, const char *name, uint16_t ram)
+{
+	out->print(name);
+	out->print('\t');
+	out->print(ram);
+	out->print('\n');
+}
+
+#define PRINT_CLASS(out, type) printRow(out, #type, sizeof(type))
+
+///////////////////////////////////////////////////////////////////////////
+// MenuFootprint
+///////////////////////////////////////////////////////////////////////////
+
+void MenuFootprint::printClasses(Print *out)
+{
+	assert(out != NULL);
+	out->print(F("# flash per class is not measured, see the linker map\n"));
+	out->print(F("class\tram\n"));
+	PRINT_CLASS(out, Screen);
+	PRINT_CLASS(out, Property);
+	PRINT_CLASS(out, PropertyTime);
+	PRINT_CLASS(out, PropertyDate);
+	PRINT_CLASS(out, PropertyU16);
+	PRINT_CLASS(out, PropertyIntBase); // every PropertyInt<> instantiation
+	PRINT_CLASS(out, PropertyBool);
+	PRINT_CLASS(out, PropertyAction);
+	PRINT_CLASS(out, PropertyLive);
+	PRINT_CLASS(out, Page);
+	PRINT_CLASS(out, ScrollablePage);
+	PRINT_CLASS(out, PropertyPage);
+	PRINT_CLASS(out, MenuItem);
+	PRINT_CLASS(out, MenuItemPage);
+	PRINT_CLASS(out, ChangeTracker);
+	PRINT_CLASS(out, ActionQueue);
+	printRow(out, "statics", getStaticRam());
+}
+
+void MenuFootprint::printItems(Print *out, const Item *items, uint8_t count)
+{
+	assert(out != NULL);
+	assert(items != NULL || count == 0);
+	uint32_t ram = getStaticRam();
+	uint32_t flash = 0;
+	out->print(F("item\tram\tflash\n"));
+	for (uint8_t i = 0; i < count; ++i) {
+		printRow(out, items[i].name, items[i].ram, items[i].flash);
+		ram += items[i].ram;
+		flash += items[i].flash;
+	}
+	printRow(out, "statics", getStaticRam(), 0);
+	out->print(F("total\t"));
+	out->print(ram);
+	out->print('\t');
+	out->print(flash);
+	out->print('\n');
+}
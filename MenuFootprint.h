@@ -0,0 +1,73 @@
+/*
+  MenuFootprint.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MENU_FOOTPRINT_H_
+#define MENU_FOOTPRINT_H_
+
+#include "PropertyMenu.h"
+
+///////////////////////////////////////////////////////////////////////////
+// MenuFootprint
+///////////////////////////////////////////////////////////////////////////
+
+// RAM and flash taken by the library classes and by a menu definition.
+// The objects and labels of a menu are listed once, as X-macros, and summed
+// at compile time for a budget check and into a table for the report:
+//   #define MY_OBJECTS(X) X(clockTime) X(clockProp) X(settingsPropPage)
+//   #define MY_LABELS(X) X(LBL_TIME) X(LBL_SETTINGS)
+//   enum {
+//     MY_RAM = 0 MY_OBJECTS(FOOTPRINT_RAM) MY_LABELS(FOOTPRINT_LABEL_RAM),
+//     MY_FLASH = 0 MY_LABELS(FOOTPRINT_LABEL_FLASH)
+//   };
+//   FOOTPRINT_CHECK(MY_RAM, 512, menuRamOverBudget);
+//   const MenuFootprint::Item myItems[] = {
+//     MY_OBJECTS(FOOTPRINT_RAM_ITEM) MY_LABELS(FOOTPRINT_LABEL_ITEM)
+//   };
+// Sizes are those of the compiler building it: check budgets in the
+// firmware build, pointers are wider in the simulator.
+class MenuFootprint
+{
+public:
+	struct Item {
+		const char *name;
+		uint16_t ram;
+		uint16_t flash;
+	};
+	// RAM of the library's static variables and tables, counted once: the
+	// static pointers of Property, PropertyAction and MenuTrace included
+	static uint16_t getStaticRam();
+	// sizeof every class of PropertyMenu.h, one per line; their code and
+	// vtables are not measured, the linker map has them
+	static void printClasses(Print *out);
+	// the items and their totals, the library statics included
+	static void printItems(Print *out, const Item *items, uint8_t count);
+};
+
+#define FOOTPRINT_RAM(object) + sizeof(object)
+// a MakeFlashString() label: the text in flash, the pointer to it in RAM
+#define FOOTPRINT_LABEL_RAM(label) + sizeof(label)
+#define FOOTPRINT_LABEL_FLASH(label) + sizeof(__##label)
+#define FOOTPRINT_RAM_ITEM(object) { #object, sizeof(object), 0 },
+#define FOOTPRINT_LABEL_ITEM(label) { #label, sizeof(label), sizeof(__##label) },
+// fails the build with a negative array size when bytes exceed budget
+#define FOOTPRINT_CHECK(bytes, budget, name) \
+	typedef char name[((bytes) <= (budget)) ? 1 : -1]
+
+#endif // MENU_FOOTPRINT_H_
@@ -0,0 +1,189 @@
+/*
+  MenuIndex.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "MenuIndex.h"
+#ifndef _WIN32
+#include <avr/pgmspace.h>
+#endif
+
+static const uint32_t FNV_OFFSET = 2166136261UL;
+static const uint32_t FNV_PRIME = 16777619UL;
+static const char PATH_SEPARATOR = '/';
+
+static uint32_t fnvAdd(uint32_t hash, char c)
+{
+	return (hash ^ static_cast<uint8_t>(c)) * FNV_PRIME;
+}
+
+static uint32_t fnvAddName(uint32_t hash, const __FlashStringHelper *name)
+{
+	const char *p = reinterpret_cast<const char *>(name);
+	for (;;) {
+#ifdef _WIN32
+		char c = *p++;
+#else
+		char c = pgm_read_byte(p++);
+#endif
+		if (c == 0) {
+			return hash;
+		}
+		hash = fnvAdd(hash, c);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+// MenuIndex
+///////////////////////////////////////////////////////////////////////////
+
+MenuIndex::MenuIndex(Entry *storage, uint8_t capacity)
+: _entries(storage),
+	_capacity(capacity),
+	_count(0),
+	_root(NULL)
+{
+	assert(storage != NULL);
+}
+
+const MenuIndex::Entry *MenuIndex::getEntry(uint8_t i) const
+{
+	assert(i < _count);
+	return &_entries[i];
+}
+
+uint32_t MenuIndex::hashPath(const char *path)
+{
+	assert(path != NULL);
+	uint32_t hash = FNV_OFFSET;
+	while (*path != 0) {
+		hash = fnvAdd(hash, *path++);
+	}
+	return hash;
+}
+
+uint32_t MenuIndex::hashPath(const char *begin, const char *end)
+{
+	assert(begin != NULL && begin <= end);
+	uint32_t hash = FNV_OFFSET;
+	while (begin != end) {
+		hash = fnvAdd(hash, *begin++);
+	}
+	return hash;
+}
+
+bool MenuIndex::build(Page *root)
+{
+	assert(root != NULL);
+	_root = root;
+	_count = 0;
+	return walk(root, NO_PARENT, 0);
+}
+
+bool MenuIndex::walk(Page *page, uint32_t pageId, uint8_t depth)
+{
+	if (depth == MenuNavigator::MAX_DEPTH) {
+		return false;
+	}
+	uint8_t lines = page->getLineCount();
+	for (uint8_t i = 0; i < lines; ++i) {
+		const __FlashStringHelper *name = page->getLineName(i);
+		if (name == NULL) {
+			continue;
+		}
+		uint32_t id = pageId == NO_PARENT ? FNV_OFFSET : fnvAdd(pageId, PATH_SEPARATOR);
+		id = fnvAddName(id, name);
+		if (!add(id, pageId, page, i)) {
+			return false;
+		}
+		Page *child = page->getChildPage(i + 1);
+		if (child != NULL && !walk(child, id, depth + 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// insertion keeps the array sorted, fine for the few lines of a menu
+bool MenuIndex::add(uint32_t id, uint32_t parentId, Page *page, uint8_t idx)
+{
+	if (_count == _capacity || id == NO_PARENT || find(id) != NULL) {
+		return false;
+	}
+	uint8_t pos = _count;
+	while (pos > 0 && _entries[pos - 1].id > id) {
+		_entries[pos] = _entries[pos - 1];
+		--pos;
+	}
+	Entry &e = _entries[pos];
+	e.id = id;
+	e.parentId = parentId;
+	e.page = page;
+	e.idx = idx;
+	_count++;
+	return true;
+}
+
+const MenuIndex::Entry *MenuIndex::find(uint32_t id) const
+{
+	uint8_t low = 0;
+	uint8_t high = _count;
+	while (low < high) {
+		uint8_t mid = (low + high) / 2;
+		if (_entries[mid].id < id) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low < _count && _entries[low].id == id ? &_entries[low] : NULL;
+}
+
+Property *MenuIndex::findProperty(uint32_t id) const
+{
+	const Entry *e = find(id);
+	return e != NULL ? e->page->getProperty(e->idx) : NULL;
+}
+
+bool MenuIndex::jump(MenuNavigator *navigator, uint32_t id) const
+{
+	assert(navigator != NULL);
+	Page *path[MenuNavigator::MAX_DEPTH];
+	uint8_t lines[MenuNavigator::MAX_DEPTH];
+	uint8_t depth = 0;
+	// from the line up to the root, then reversed
+	const Entry *e = find(id);
+	while (e != NULL && depth < MenuNavigator::MAX_DEPTH) {
+		path[depth] = e->page;
+		lines[depth] = e->idx + 1;
+		depth++;
+		e = e->parentId == NO_PARENT ? NULL : find(e->parentId);
+	}
+	if (depth == 0 || path[depth - 1] != _root) {
+		return false;
+	}
+	for (uint8_t i = 0; i < depth / 2; ++i) {
+		Page *p = path[i];
+		path[i] = path[depth - 1 - i];
+		path[depth - 1 - i] = p;
+		uint8_t l = lines[i];
+		lines[i] = lines[depth - 1 - i];
+		lines[depth - 1 - i] = l;
+	}
+	return navigator->jump(path, lines, depth);
+}
@@ -0,0 +1,70 @@
+/*
+  MenuIndex.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MENU_INDEX_H_
+#define MENU_INDEX_H_
+
+#include "PropertyMenu.h"
+#include "MenuNavigator.h"
+
+///////////////////////////////////////////////////////////////////////////
+// MenuIndex
+///////////////////////////////////////////////////////////////////////////
+
+// Stable IDs for every line of the menu: the FNV-1a hash of its path of
+// names from the root, e.g. "Recordings/Time start". build() walks the
+// menu once at startup into a caller sized array sorted by ID, so a lookup
+// is a binary search instead of a replay of button presses.
+class MenuIndex
+{
+public:
+	enum {
+		NO_PARENT = 0
+	};
+	struct Entry {
+		uint32_t id;
+		uint32_t parentId; // menu line that opens page, NO_PARENT at the root
+		Page *page;
+		uint8_t idx; // line in page, 0 based
+	};
+	MenuIndex(Entry *storage, uint8_t capacity);
+	// false if the menu does not fit or two paths hash the same
+	bool build(Page *root);
+	uint8_t getCount() const { return _count; }
+	const Entry *getEntry(uint8_t i) const;
+	static uint32_t hashPath(const char *path);
+	static uint32_t hashPath(const char *begin, const char *end);
+	const Entry *find(uint32_t id) const;
+	Property *findProperty(uint32_t id) const;
+	Property *findProperty(const char *path) const { return findProperty(hashPath(path)); }
+	// opens the page holding the line with the cursor on it
+	bool jump(MenuNavigator *navigator, uint32_t id) const;
+
+private:
+	bool add(uint32_t id, uint32_t parentId, Page *page, uint8_t idx);
+	bool walk(Page *page, uint32_t pageId, uint8_t depth);
+
+	Entry *_entries;
+	uint8_t _capacity;
+	uint8_t _count;
+	Page *_root;
+};
+
+#endif // MENU_INDEX_H_
@@ -0,0 +1,112 @@
+/*
+  MenuNavigator.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "MenuNavigator.h"
+
+///////////////////////////////////////////////////////////////////////////
+// MenuNavigator
+///////////////////////////////////////////////////////////////////////////
+
+MenuNavigator::MenuNavigator(Screen *screen, Page *root)
+: _screen(screen),
+	_cache(NULL),
+	_depth(1)
+{
+	assert(screen != NULL);
+	assert(root != NULL);
+	_stack[0].page = root;
+	_stack[0].state = root->getState();
+}
+
+bool MenuNavigator::push(Page *page)
+{
+	assert(page != NULL);
+	if (_depth == MAX_DEPTH) {
+		return false;
+	}
+	Entry &parent = _stack[_depth - 1];
+	parent.state = parent.page->getState();
+	if (_cache != NULL) {
+		_cache->store(parent.page);
+	}
+	Entry &e = _stack[_depth++];
+	e.page = page;
+	page->reset();
+	e.state = page->getState();
+	page->paint(_screen);
+	return true;
+}
+
+bool MenuNavigator::pop()
+{
+	if (_depth == 1) {
+		return false;
+	}
+	_depth--;
+	Entry &e = _stack[_depth - 1];
+	e.page->setState(e.state);
+	if (_cache == NULL || !_cache->restore(e.page)) {
+		e.page->paint(_screen);
+	}
+	return true;
+}
+
+bool MenuNavigator::jump(Page *const path[], const uint8_t lines[], uint8_t count)
+{
+	assert(path != NULL);
+	assert(lines != NULL);
+	if (count == 0 || count > MAX_DEPTH || path[0] != _stack[0].page) {
+		return false;
+	}
+	// the pages replaced leave any edit in progress; the root is kept, but
+	// it may be editing if it was on top
+	for (uint8_t i = _depth - 1; i > 0; --i) {
+		if (i >= count || path[i] != _stack[i].page) {
+			_stack[i].page->reset();
+		}
+	}
+	if (_depth == 1) {
+		_stack[0].page->reset();
+	}
+	for (uint8_t i = 0; i < count; ++i) {
+		Page *page = path[i];
+		if (i > 0) {
+			page->reset();
+		}
+		page->showLine(lines[i], _screen->getRows());
+		_stack[i].page = page;
+		_stack[i].state = page->getState();
+	}
+	_depth = count;
+	getPage()->paint(_screen);
+	return true;
+}
+
+bool MenuNavigator::handleResult(uint8_t line)
+{
+	if (line == Page::INVALID_LINE) {
+		return false;
+	}
+	Page *child = getPage()->getChildPage(line);
+	if (child != NULL) {
+		return push(child);
+	}
+	return line == 0 && pop();
+}
@@ -0,0 +1,66 @@
+/*
+  MenuNavigator.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MENU_NAVIGATOR_H_
+#define MENU_NAVIGATOR_H_
+
+#include "PropertyMenu.h"
+#include "FrameCache.h"
+
+///////////////////////////////////////////////////////////////////////////
+// MenuNavigator
+///////////////////////////////////////////////////////////////////////////
+
+// Stack of open pages: follows Page::getChildPage() on the lines returned
+// by buttonInput() and goes back to the parent on line 0, restoring its
+// scroll/cursor position, or jumps to any page along a known path (see
+// MenuIndex). With a FrameCache the parent is shown again
+// from its last frame instead of being repainted.
+class MenuNavigator
+{
+public:
+	enum {
+		MAX_DEPTH = 4
+	};
+	MenuNavigator(Screen *screen, Page *root);
+	Page *getPage() const { return _stack[_depth - 1].page; }
+	uint8_t getDepth() const { return _depth; }
+	bool push(Page *page);
+	bool pop();
+	// replaces the stack with path[0..count-1], path[0] being the root,
+	// showing lines[i] of each page, and paints the last page once
+	bool jump(Page *const path[], const uint8_t lines[], uint8_t count);
+	// acts on a result of Page::buttonInput(), true if the page changed
+	bool handleResult(uint8_t line);
+	void setFrameCache(FrameCache *cache) { _cache = cache; }
+
+private:
+	struct Entry {
+		Page *page;
+		uint16_t state;
+	};
+
+	Screen *_screen;
+	FrameCache *_cache;
+	Entry _stack[MAX_DEPTH];
+	uint8_t _depth;
+};
+
+#endif // MENU_NAVIGATOR_H_
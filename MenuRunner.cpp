@@ -0,0 +1,169 @@
+/*
+  MenuRunner.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "MenuRunner.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// InputSource
+///////////////////////////////////////////////////////////////////////////
+
+InputSource::~InputSource()
+{
+}
+
+#ifdef __AVR__
+SleepInputSource::SleepInputSource(ClockCallback clock)
+: _clock(clock)
+{
+	assert(clock != NULL);
+}
+
+void SleepInputSource::wait(const ButtonEventQueue *queue, uint32_t timeoutMs)
+{
+	uint32_t start = _clock();
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	for (;;) {
+		cli();
+		if (!queue->isEmpty() || _clock() - start >= timeoutMs) {
+			sei();
+			break;
+		}
+		// sei() takes effect after the next instruction: no wakeup is lost
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+	}
+}
+
+bool SleepInputSource::read(ButtonEventQueue * /*queue*/, uint32_t /*now*/)
+{
+	return true;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// MenuRunner
+///////////////////////////////////////////////////////////////////////////
+
+MenuRunner::MenuRunner(Screen *screen, InputSource *input, ButtonEventQueue *queue,
+	ButtonRepeater *repeater, ClockCallback clock)
+: _screen(screen),
+	_input(input),
+	_queue(queue),
+	_repeater(repeater),
+	_actions(NULL),
+	_dispatcher(queue, repeater),
+	_clock(clock),
+	_page(NULL),
+	_scheduler(NULL),
+	_taskBudget(0),
+	_pollDeadline(0),
+	_running(true)
+{
+	assert(screen != NULL);
+	assert(input != NULL);
+	assert(queue != NULL);
+	assert(clock != NULL);
+}
+
+void MenuRunner::setPage(Page *page)
+{
+	assert(page != NULL);
+	_page = page;
+	_pollDeadline = _clock() + page->getPollPeriod();
+}
+
+void MenuRunner::setScheduler(TaskScheduler *scheduler, uint32_t budgetMs)
+{
+	_scheduler = scheduler;
+	_taskBudget = budgetMs;
+}
+
+uint32_t MenuRunner::timeToNextDeadline(uint32_t now) const
+{
+	uint32_t timeout = TaskScheduler::WAIT_FOREVER;
+	if (_repeater != NULL && _repeater->hasPending()) {
+		return 0;
+	}
+	if (_actions != NULL && !_actions->isIdle()) {
+		return 0;
+	}
+	if (_repeater != NULL && _repeater->isHeld()) {
+		int32_t left = static_cast<int32_t>(_repeater->getNextDeadline() - now);
+		timeout = left > 0 ? left : 0;
+	}
+	if (_scheduler != NULL) {
+		uint32_t t = _scheduler->getTimeToNext(now);
+		if (t < timeout) {
+			timeout = t;
+		}
+	}
+	if (_page != NULL && _page->getPollPeriod() > 0) {
+		uint32_t t = timeReached(now, _pollDeadline) ? 0 : _pollDeadline - now;
+		if (t < timeout) {
+			timeout = t;
+		}
+	}
+	return timeout;
+}
+
+uint8_t MenuRunner::runOnce()
+{
+	assert(_page != NULL);
+	// the caller has handled the result of the previous round
+	_dispatcher.endInput();
+	uint32_t now = _clock();
+	if (_queue->isEmpty()) {
+		uint32_t timeout = timeToNextDeadline(now);
+		if (timeout > 0) {
+			_input->wait(_queue, timeout);
+		}
+	}
+	now = _clock();
+	if (!_input->read(_queue, now)) {
+		_running = false;
+		return Page::INVALID_LINE;
+	}
+	uint8_t line = _dispatcher.dispatch(_page, _screen, now);
+	if (line == Page::INVALID_LINE) {
+		if (_scheduler != NULL) {
+			_scheduler->runDue(_taskBudget);
+		}
+		if (_actions != NULL) {
+			_actions->runStep();
+		}
+		_page->refresh(_screen);
+		uint16_t period = _page->getPollPeriod();
+		if (period > 0 && timeReached(now, _pollDeadline)) {
+			_pollDeadline += period;
+			if (timeReached(now, _pollDeadline)) {
+				_pollDeadline = now + period;
+			}
+			_page->poll(_screen);
+		}
+	}
+	return line;
+}
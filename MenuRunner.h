@@ -0,0 +1,101 @@
+/*
+  MenuRunner.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MENU_RUNNER_H_
+#define MENU_RUNNER_H_
+
+#include "PropertyMenu.h"
+#include "ButtonInput.h"
+#include "ActionQueue.h"
+#include "TaskScheduler.h"
+
+///////////////////////////////////////////////////////////////////////////
+// InputSource
+///////////////////////////////////////////////////////////////////////////
+
+class InputSource
+{
+public:
+	enum {
+		WAIT_FOREVER = TaskScheduler::WAIT_FOREVER
+	};
+	virtual ~InputSource();
+	// blocks until input may be available or timeoutMs elapsed
+	virtual void wait(const ButtonEventQueue *queue, uint32_t timeoutMs) = 0;
+	// moves available input to the queue, false when asked to quit
+	virtual bool read(ButtonEventQueue *queue, uint32_t now) = 0;
+};
+
+#ifdef __AVR__
+// Buttons are pushed to the queue by a pin-change ISR: sleeps in idle mode
+// until an interrupt arrives (the millis() timer wakes it every ms).
+class SleepInputSource: public InputSource
+{
+public:
+	explicit SleepInputSource(ClockCallback clock);
+	void wait(const ButtonEventQueue *queue, uint32_t timeoutMs);
+	bool read(ButtonEventQueue *queue, uint32_t now);
+
+private:
+	ClockCallback _clock;
+};
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////
+// MenuRunner
+///////////////////////////////////////////////////////////////////////////
+
+// Main loop that sleeps until there is input, a scheduled task or the page
+// poll is due instead of polling at a fixed rate. Queued actions run one slice per
+// turn, after input, so the menu stays responsive while they progress;
+// due tasks run within a time budget for the same reason.
+class MenuRunner
+{
+public:
+	MenuRunner(Screen *screen, InputSource *input, ButtonEventQueue *queue,
+		ButtonRepeater *repeater, ClockCallback clock);
+	Page *getPage() const { return _page; }
+	void setPage(Page *page);
+	void setActionQueue(ActionQueue *actions) { _actions = actions; }
+	// tasks run after input for at most budgetMs per turn (at least one)
+	void setScheduler(TaskScheduler *scheduler, uint32_t budgetMs);
+	bool isRunning() const { return _running; }
+	// waits for work and handles it, returns the page result like Page::buttonInput
+	uint8_t runOnce();
+
+private:
+	uint32_t timeToNextDeadline(uint32_t now) const;
+
+	Screen *_screen;
+	InputSource *_input;
+	ButtonEventQueue *_queue;
+	ButtonRepeater *_repeater;
+	ActionQueue *_actions;
+	ButtonDispatcher _dispatcher;
+	ClockCallback _clock;
+	Page *_page;
+	TaskScheduler *_scheduler;
+	uint32_t _taskBudget;
+	uint32_t _pollDeadline;
+	bool _running;
+};
+
+#endif // MENU_RUNNER_H_
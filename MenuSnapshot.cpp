@@ -0,0 +1,322 @@
+/*
+  MenuSnapshot.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "MenuSnapshot.h"
+#ifndef _WIN32
+#include <avr/pgmspace.h>
+#endif
+
+// bits needed to store 0..n
+static uint8_t bitsFor(uint32_t n)
+{
+	uint8_t bits = 0;
+	while (n > 0) {
+		bits++;
+		n >>= 1;
+	}
+	return bits;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// BitWriter
+///////////////////////////////////////////////////////////////////////////
+
+BitWriter::BitWriter(uint8_t *buffer, uint16_t size)
+: _buffer(buffer),
+	_size(size),
+	_bitPos(0),
+	_overflowed(false)
+{
+	assert(buffer != NULL || size == 0);
+}
+
+void BitWriter::write(uint32_t value, uint8_t bits)
+{
+	assert(bits <= 32);
+	if (_bitPos + bits > static_cast<uint32_t>(_size) * 8) {
+		_overflowed = true;
+		return;
+	}
+	for (uint8_t i = 0; i < bits; ++i) {
+		uint8_t mask = 1 << (_bitPos & 7);
+		uint8_t *b = &_buffer[_bitPos >> 3];
+		if ((value >> i) & 1) {
+			*b |= mask;
+		} else {
+			*b &= ~mask;
+		}
+		_bitPos++;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+// BitReader
+///////////////////////////////////////////////////////////////////////////
+
+BitReader::BitReader(const uint8_t *data, uint16_t size, bool inFlash)
+: _data(data),
+	_size(size),
+	_bitPos(0),
+	_inFlash(inFlash),
+	_overflowed(false)
+{
+	assert(data != NULL || size == 0);
+}
+
+uint8_t BitReader::byteAt(uint16_t idx) const
+{
+#ifndef _WIN32
+	if (_inFlash) {
+		return pgm_read_byte(_data + idx);
+	}
+#endif
+	return _data[idx];
+}
+
+uint32_t BitReader::read(uint8_t bits)
+{
+	assert(bits <= 32);
+	if (_bitPos + bits > static_cast<uint32_t>(_size) * 8) {
+		_overflowed = true;
+		return 0;
+	}
+	uint32_t value = 0;
+	for (uint8_t i = 0; i < bits; ++i) {
+		if ((byteAt(_bitPos >> 3) >> (_bitPos & 7)) & 1) {
+			value |= static_cast<uint32_t>(1) << i;
+		}
+		_bitPos++;
+	}
+	return value;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// SnapshotWalk
+///////////////////////////////////////////////////////////////////////////
+
+// One traversal shared by measure, save and load, so the three can never
+// disagree on the layout. Every field also feeds the layout signature.
+class SnapshotWalk
+{
+public:
+	enum Mode {
+		MODE_MEASURE,
+		MODE_SAVE,
+		MODE_LOAD
+	};
+	SnapshotWalk(Mode mode, BitWriter *writer, BitReader *reader);
+	void page(Page *p, uint8_t depth);
+	uint32_t getBits() const { return _bits; }
+	uint16_t getSignature() const { return (_b << 8) | _a; }
+
+private:
+	uint32_t field(uint32_t value, uint8_t bits);
+	uint32_t rangeField(uint32_t value, uint32_t low, uint32_t high);
+	void property(Property *p);
+	void value(Property *p);
+
+	Mode _mode;
+	BitWriter *_writer;
+	BitReader *_reader;
+	uint32_t _bits;
+	uint16_t _a;
+	uint16_t _b;
+};
+
+SnapshotWalk::SnapshotWalk(Mode mode, BitWriter *writer, BitReader *reader)
+: _mode(mode),
+	_writer(writer),
+	_reader(reader),
+	_bits(0),
+	_a(1),
+	_b(0)
+{
+}
+
+// returns the value to store back, unchanged unless loading
+uint32_t SnapshotWalk::field(uint32_t value, uint8_t bits)
+{
+	_a = (_a + bits) % 255;
+	_b = (_b + _a) % 255;
+	_bits += bits;
+	if (_mode == MODE_SAVE) {
+		_writer->write(value, bits);
+	} else if (_mode == MODE_LOAD) {
+		value = _reader->read(bits);
+	}
+	return value;
+}
+
+// value in low..high stored as its offset, clipped into range both ways
+uint32_t SnapshotWalk::rangeField(uint32_t value, uint32_t low, uint32_t high)
+{
+	if (value < low) {
+		value = low;
+	} else if (value > high) {
+		value = high;
+	}
+	uint32_t offset = field(value - low, bitsFor(high - low));
+	return offset > high - low ? high : low + offset;
+}
+
+// a staged property is walked on its committed variable, a snapshot
+// neither sees nor loads into the shadow being edited
+void SnapshotWalk::property(Property *p)
+{
+	if (!p->isStaged()) {
+		value(p);
+		return;
+	}
+	uint8_t size;
+	void *shadow = p->getStorage(&size);
+	p->setStorage(p->getCommittedStorage(&size));
+	value(p);
+	p->setStorage(shadow);
+}
+
+void SnapshotWalk::value(Property *p)
+{
+	switch (p->getKind()) {
+		case Property::KIND_BOOL: {
+			bool *v = static_cast<PropertyBool *>(p)->getVar();
+			*v = field(*v ? 1 : 0, 1) != 0;
+			break;
+		}
+		case Property::KIND_TIME: {
+			PropertyTime::Time *v = static_cast<PropertyTime *>(p)->getVar();
+			v->hour = rangeField(v->hour, 0, 23);
+			v->mins = rangeField(v->mins, 0, 59);
+			break;
+		}
+		case Property::KIND_DATE: {
+			PropertyDate::Date *v = static_cast<PropertyDate *>(p)->getVar();
+			v->year2000 = rangeField(v->year2000, 0, 99);
+			v->month = rangeField(v->month, 1, 12);
+			v->day = rangeField(v->day, 1, 31);
+			break;
+		}
+		case Property::KIND_U16: {
+			PropertyU16 *u = static_cast<PropertyU16 *>(p);
+			uint16_t *v = u->getVar();
+			*v = rangeField(*v, u->getLimitMin(), u->getLimitMax());
+			break;
+		}
+		case Property::KIND_INT: {
+			PropertyIntBase *i = static_cast<PropertyIntBase *>(p);
+			uint32_t offset = field(i->getOffset(), bitsFor(i->getRange()));
+			if (_mode == MODE_LOAD) {
+				i->setOffset(offset);
+			}
+			break;
+		}
+		case Property::KIND_ACTION:
+		case Property::KIND_LIVE:
+			break;
+		default: {
+			// custom storage as plain bytes
+			uint8_t size;
+			uint8_t *v = static_cast<uint8_t *>(p->getStorage(&size));
+			for (uint8_t j = 0; j < size; ++j) {
+				v[j] = field(v[j], 8);
+			}
+			break;
+		}
+	}
+}
+
+void SnapshotWalk::page(Page *p, uint8_t depth)
+{
+	assert(depth < MenuSnapshot::MAX_DEPTH);
+	uint8_t lines = p->getLineCount();
+	// pages keep their position in two bytes, each at most the line count
+	uint16_t state = p->getState();
+	uint8_t hi = rangeField(state >> 8, 0, lines);
+	uint8_t lo = rangeField(state & 0xff, 0, lines);
+	if (_mode == MODE_LOAD) {
+		if (hi + lo > lines) {
+			hi = 0;
+			lo = 0;
+		}
+		p->setState((static_cast<uint16_t>(hi) << 8) | lo);
+	}
+	for (uint8_t i = 0; i < lines; ++i) {
+		Property *prop = p->getProperty(i);
+		if (prop != NULL) {
+			property(prop);
+		}
+	}
+	for (uint8_t line = 1; line <= lines; ++line) {
+		Page *child = p->getChildPage(line);
+		if (child != NULL) {
+			page(child, depth + 1);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+// MenuSnapshot
+///////////////////////////////////////////////////////////////////////////
+
+uint16_t MenuSnapshot::measure(Page *root)
+{
+	assert(root != NULL);
+	SnapshotWalk walk(SnapshotWalk::MODE_MEASURE, NULL, NULL);
+	walk.page(root, 0);
+	return HEADER_SIZE + (walk.getBits() + 7) / 8;
+}
+
+uint16_t MenuSnapshot::save(Page *root, uint8_t *buffer, uint16_t size)
+{
+	assert(root != NULL);
+	assert(buffer != NULL);
+	if (size < HEADER_SIZE) {
+		return 0;
+	}
+	BitWriter writer(buffer + HEADER_SIZE, size - HEADER_SIZE);
+	SnapshotWalk walk(SnapshotWalk::MODE_SAVE, &writer, NULL);
+	walk.page(root, 0);
+	if (writer.isOverflowed()) {
+		return 0;
+	}
+	uint16_t signature = walk.getSignature();
+	buffer[0] = FORMAT;
+	buffer[1] = signature & 0xff;
+	buffer[2] = signature >> 8;
+	return HEADER_SIZE + writer.getBytes();
+}
+
+bool MenuSnapshot::load(Page *root, const uint8_t *data, uint16_t size, bool inFlash)
+{
+	assert(root != NULL);
+	assert(data != NULL);
+	BitReader header(data, size, inFlash);
+	uint8_t format = header.read(8);
+	uint16_t signature = header.read(16);
+	SnapshotWalk check(SnapshotWalk::MODE_MEASURE, NULL, NULL);
+	check.page(root, 0);
+	if (header.isOverflowed() || format != FORMAT || signature != check.getSignature()
+		|| HEADER_SIZE + (check.getBits() + 7) / 8 > size) {
+		return false;
+	}
+	BitReader reader(data + HEADER_SIZE, size - HEADER_SIZE, inFlash);
+	SnapshotWalk walk(SnapshotWalk::MODE_LOAD, NULL, &reader);
+	walk.page(root, 0);
+	return true;
+}
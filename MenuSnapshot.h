@@ -0,0 +1,88 @@
+/*
+  MenuSnapshot.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MENU_SNAPSHOT_H_
+#define MENU_SNAPSHOT_H_
+
+#include "PropertyMenu.h"
+
+///////////////////////////////////////////////////////////////////////////
+// BitWriter / BitReader
+///////////////////////////////////////////////////////////////////////////
+
+// Fields packed least significant bit first into a caller buffer
+class BitWriter
+{
+public:
+	BitWriter(uint8_t *buffer, uint16_t size);
+	void write(uint32_t value, uint8_t bits);
+	bool isOverflowed() const { return _overflowed; }
+	uint16_t getBytes() const { return (_bitPos + 7) / 8; }
+
+private:
+	uint8_t *_buffer;
+	uint16_t _size;
+	uint32_t _bitPos;
+	bool _overflowed;
+};
+
+// Reads fields in place, from RAM (or a mapped file) or, when inFlash is
+// set on the AVR, from PROGMEM: no copy of the blob is needed
+class BitReader
+{
+public:
+	BitReader(const uint8_t *data, uint16_t size, bool inFlash = false);
+	uint32_t read(uint8_t bits);
+	bool isOverflowed() const { return _overflowed; }
+
+private:
+	uint8_t byteAt(uint16_t idx) const;
+
+	const uint8_t *_data;
+	uint16_t _size;
+	uint32_t _bitPos;
+	bool _inFlash;
+	bool _overflowed;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// MenuSnapshot
+///////////////////////////////////////////////////////////////////////////
+
+// Dumps every property value and every page position reachable from a
+// root page as one blob, each field in just the bits its range needs
+// (PropertyBool 1 bit, hour 5 bits...). The blob starts with a format
+// byte and a signature of the layout, so it only loads into the same menu.
+class MenuSnapshot
+{
+public:
+	enum {
+		FORMAT = 1,
+		HEADER_SIZE = 3,
+		MAX_DEPTH = 8
+	};
+	static uint16_t measure(Page *root); // bytes needed by save()
+	// bytes written, 0 if the buffer is too small
+	static uint16_t save(Page *root, uint8_t *buffer, uint16_t size);
+	// false, leaving the menu untouched, if the blob does not match it
+	static bool load(Page *root, const uint8_t *data, uint16_t size, bool inFlash = false);
+};
+
+#endif // MENU_SNAPSHOT_H_
@@ -0,0 +1,90 @@
+/*
+  MenuTrace.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "MenuTrace.h"
+
+///////////////////////////////////////////////////////////////////////////
+// MenuTrace
+///////////////////////////////////////////////////////////////////////////
+
+MenuTrace *MenuTrace::_active = NULL;
+
+MenuTrace::MenuTrace(Record *storage, uint16_t capacity, ClockCallback clock)
+: _records(storage),
+	_capacity(capacity),
+	_first(0),
+	_count(0),
+	_dropped(0),
+	_clock(clock)
+{
+	assert(storage != NULL);
+	assert(capacity > 0);
+	assert(clock != NULL);
+}
+
+void MenuTrace::begin(uint8_t scope, uint16_t arg)
+{
+	if (_active != NULL) {
+		_active->record(scope, PHASE_BEGIN, arg);
+	}
+}
+
+void MenuTrace::end(uint8_t scope)
+{
+	if (_active != NULL) {
+		_active->record(scope, PHASE_END, 0);
+	}
+}
+
+void MenuTrace::record(uint8_t scope, uint8_t phase, uint16_t arg)
+{
+	assert(scope < SCOPE_COUNT);
+	uint16_t idx = _first + _count;
+	if (idx >= _capacity) {
+		idx -= _capacity;
+	}
+	if (_count == _capacity) {
+		if (++_first == _capacity) {
+			_first = 0;
+		}
+		_dropped++;
+	} else {
+		_count++;
+	}
+	Record &r = _records[idx];
+	r.timeUs = _clock();
+	r.scope = scope;
+	r.phase = phase;
+	r.arg = arg;
+}
+
+const MenuTrace::Record &MenuTrace::getRecord(uint16_t idx) const
+{
+	assert(idx < _count);
+	uint16_t i = _first + idx;
+	return _records[i >= _capacity ? i - _capacity : i];
+}
+
+void MenuTrace::clear()
+{
+	_first = 0;
+	_count = 0;
+	_dropped = 0;
+}
@@ -0,0 +1,92 @@
+/*
+  MenuTrace.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MENU_TRACE_H_
+#define MENU_TRACE_H_
+
+#include "PropertyMenu.h"
+
+///////////////////////////////////////////////////////////////////////////
+// MenuTrace
+///////////////////////////////////////////////////////////////////////////
+
+// Ring of timestamped begin and end records of the scopes below, to see
+// how long a button press takes to reach the display. The library records
+// through the TRACE_BEGIN() and TRACE_END() macros, compiled in only when
+// PROPERTY_MENU_TRACE is defined, into the trace set active. When the ring
+// is full the oldest records are overwritten.
+class MenuTrace
+{
+public:
+	enum Scope {
+		SCOPE_INPUT, // a button dispatched until ButtonDispatcher::endInput()
+		SCOPE_BUTTON_INPUT, // Page::buttonInput()
+		SCOPE_PAINT, // Page::paint(), arg is getPageId()
+		SCOPE_PAINT_LINE, // PropertyPage::paintLine(), arg is the line
+		SCOPE_FLUSH, // ShadowLCD::blit()
+		SCOPE_COUNT
+	};
+	enum Phase {
+		PHASE_BEGIN,
+		PHASE_END
+	};
+	struct Record {
+		uint32_t timeUs;
+		uint8_t scope;
+		uint8_t phase;
+		uint16_t arg;
+	};
+	// clock gives microseconds, like micros()
+	MenuTrace(Record *storage, uint16_t capacity, ClockCallback clock);
+	static void setActive(MenuTrace *trace) { _active = trace; }
+	static MenuTrace *getActive() { return _active; }
+	static void begin(uint8_t scope, uint16_t arg);
+	static void end(uint8_t scope);
+	void record(uint8_t scope, uint8_t phase, uint16_t arg);
+	// the RAM address of the page on AVR, its low 16 bits on the host
+	static uint16_t getPageId(const Page *page)
+	{
+		return static_cast<uint16_t>(reinterpret_cast<uintptr_t>(page));
+	}
+	uint16_t getCount() const { return _count; }
+	const Record &getRecord(uint16_t idx) const; // 0 is the oldest
+	uint32_t getDropped() const { return _dropped; }
+	void clear();
+
+private:
+	static MenuTrace *_active;
+
+	Record *_records;
+	uint16_t _capacity;
+	uint16_t _first;
+	uint16_t _count;
+	uint32_t _dropped;
+	ClockCallback _clock;
+};
+
+#ifdef PROPERTY_MENU_TRACE
+#define TRACE_BEGIN(scope, arg) MenuTrace::begin(MenuTrace::scope, arg)
+#define TRACE_END(scope) MenuTrace::end(MenuTrace::scope)
+#else
+#define TRACE_BEGIN(scope, arg)
+#define TRACE_END(scope)
+#endif
+
+#endif // MENU_TRACE_H_
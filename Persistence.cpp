@@ -0,0 +1,305 @@
+/*
+  Persistence.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include "Persistence.h"
+#ifndef _WIN32
+#include <avr/eeprom.h>
+#endif
+
+// Fletcher-16 over sequence, mask and values, seeded with the layout
+// signature: a record written for other properties fails even when its
+// size is the same. The seed never leaves _a at 0, so both an erased
+// (0xff) and a zeroed slot fail too.
+class RecordChecksum
+{
+public:
+	explicit RecordChecksum(uint16_t seed)
+	: _a(1),
+		_b(0)
+	{
+		add(seed & 0xff);
+		add(seed >> 8);
+		if (_a == 0) {
+			_a = 1;
+		}
+	}
+	void add(uint8_t v)
+	{
+		_a = (_a + v) % 255;
+		_b = (_b + _a) % 255;
+	}
+	uint16_t get() const { return (_b << 8) | _a; }
+
+private:
+	uint16_t _a;
+	uint16_t _b;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// EepromDevice
+///////////////////////////////////////////////////////////////////////////
+
+EepromDevice::~EepromDevice()
+{
+}
+
+#ifndef _WIN32
+uint16_t AvrEeprom::getSize() const
+{
+	return E2END + 1;
+}
+
+uint8_t AvrEeprom::read(uint16_t addr) const
+{
+	return eeprom_read_byte(reinterpret_cast<const uint8_t *>(addr));
+}
+
+void AvrEeprom::write(uint16_t addr, uint8_t value)
+{
+	eeprom_write_byte(reinterpret_cast<uint8_t *>(addr), value);
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// PersistStore
+///////////////////////////////////////////////////////////////////////////
+
+PersistStore::PersistStore(EepromDevice *device, Property **propertiesAry, uint16_t addr, uint16_t size)
+: _device(device),
+	_propertiesAry(propertiesAry),
+	_addr(addr),
+	_layout(0),
+	_maskSize(0),
+	_recordSize(HEADER_SIZE + TRAILER_SIZE),
+	_slotCount(0),
+	_slot(NO_SLOT),
+	_sequence(0),
+	_saveCount(0),
+	_bytesWritten(0)
+{
+	assert(device != NULL);
+	assert(propertiesAry != NULL);
+	assert(static_cast<uint32_t>(addr) + size <= device->getSize());
+	// the kind and size of every property make the layout signature
+	RecordChecksum layout(0);
+	uint16_t count = 0;
+	for (Property **p = _propertiesAry; *p != NULL; ++p) {
+		uint8_t varSize;
+		(*p)->getCommittedStorage(&varSize);
+		_recordSize += varSize;
+		layout.add((*p)->getKind());
+		layout.add(varSize);
+		count++;
+	}
+	// property indexes are uint8_t
+	assert(count <= 0xff);
+	_layout = layout.get();
+	_maskSize = static_cast<uint8_t>((count + 7) / 8);
+	_recordSize += _maskSize;
+	uint16_t slots = size / _recordSize;
+	_slotCount = slots < NO_SLOT ? static_cast<uint8_t>(slots) : NO_SLOT - 1;
+	assert(_slotCount > 0);
+}
+
+uint16_t PersistStore::slotAddr(uint8_t slot) const
+{
+	return _addr + slot * _recordSize;
+}
+
+uint8_t PersistStore::nextSlot(uint8_t slot) const
+{
+	return slot == NO_SLOT || slot + 1 >= _slotCount ? 0 : slot + 1;
+}
+
+uint16_t PersistStore::readU16(uint16_t addr) const
+{
+	return _device->read(addr) | (_device->read(addr + 1) << 8);
+}
+
+void PersistStore::update(uint16_t addr, uint8_t value)
+{
+	if (_device->read(addr) != value) {
+		_device->write(addr, value);
+		_bytesWritten++;
+	}
+}
+
+bool PersistStore::hasValue(uint8_t slot, uint8_t index) const
+{
+	uint8_t mask = _device->read(slotAddr(slot) + HEADER_SIZE + index / 8);
+	return (mask & (1 << (index % 8))) != 0;
+}
+
+// values left out of the mask are not covered
+uint16_t PersistStore::checksum(uint8_t slot) const
+{
+	uint16_t addr = slotAddr(slot);
+	RecordChecksum sum(_layout);
+	uint16_t a = addr;
+	for (; a < addr + HEADER_SIZE + _maskSize; ++a) {
+		sum.add(_device->read(a));
+	}
+	uint8_t index = 0;
+	for (Property **p = _propertiesAry; *p != NULL; ++p, ++index) {
+		uint8_t size;
+		(*p)->getCommittedStorage(&size);
+		if (hasValue(slot, index)) {
+			for (uint8_t j = 0; j < size; ++j) {
+				sum.add(_device->read(a + j));
+			}
+		}
+		a += size;
+	}
+	return sum.get();
+}
+
+// marks the valid slots in valid[] and finds the newest of them
+void PersistStore::scan(uint8_t *valid)
+{
+	memset(valid, 0, VALID_SIZE);
+	_slot = NO_SLOT;
+	for (uint8_t i = 0; i < _slotCount; ++i) {
+		uint16_t addr = slotAddr(i);
+		if (readU16(addr + _recordSize - TRAILER_SIZE) != checksum(i)) {
+			continue;
+		}
+		valid[i / 8] |= 1 << (i % 8);
+		uint16_t seq = readU16(addr);
+		if (_slot == NO_SLOT || static_cast<int16_t>(seq - _sequence) > 0) {
+			_slot = i;
+			_sequence = seq;
+		}
+	}
+}
+
+uint8_t PersistStore::findNewest(uint8_t index, const uint8_t *valid) const
+{
+	uint8_t newest = NO_SLOT;
+	uint16_t newestSeq = 0;
+	for (uint8_t i = 0; i < _slotCount; ++i) {
+		if ((valid[i / 8] & (1 << (i % 8))) == 0 || !hasValue(i, index)) {
+			continue;
+		}
+		uint16_t seq = readU16(slotAddr(i));
+		if (newest == NO_SLOT || static_cast<int16_t>(seq - newestSeq) > 0) {
+			newest = i;
+			newestSeq = seq;
+		}
+	}
+	return newest;
+}
+
+// true if the value goes in the record written to slot
+bool PersistStore::mustWrite(uint8_t index, uint16_t offset, const uint8_t *value, uint8_t size,
+	uint8_t slot, const uint8_t *valid) const
+{
+	uint8_t newest = findNewest(index, valid);
+	if (newest == NO_SLOT || newest == slot || newest == nextSlot(slot)) {
+		return true;
+	}
+	uint16_t addr = slotAddr(newest) + offset;
+	for (uint8_t j = 0; j < size; ++j) {
+		if (_device->read(addr + j) != value[j]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PersistStore::restore()
+{
+	uint8_t valid[VALID_SIZE];
+	scan(valid);
+	if (_slot == NO_SLOT) {
+		return false;
+	}
+	uint16_t offset = HEADER_SIZE + _maskSize;
+	uint8_t index = 0;
+	for (Property **p = _propertiesAry; *p != NULL; ++p, ++index) {
+		uint8_t size;
+		uint8_t *v = static_cast<uint8_t *>((*p)->getCommittedStorage(&size));
+		uint8_t slot = findNewest(index, valid);
+		if (slot != NO_SLOT) {
+			uint16_t addr = slotAddr(slot) + offset;
+			for (uint8_t j = 0; j < size; ++j) {
+				v[j] = _device->read(addr + j);
+			}
+			// the bytes passed the checksum, not the limits
+			if (size > 0) {
+				(*p)->clipStorage(v);
+			}
+		}
+		offset += size;
+	}
+	return true;
+}
+
+void PersistStore::save()
+{
+	_saveCount++;
+	uint8_t valid[VALID_SIZE];
+	scan(valid);
+	uint8_t slot = nextSlot(_slot);
+	// the delta is taken against the newest copy of every value, not
+	// against the older record the slot still holds
+	bool any = false;
+	uint16_t offset = HEADER_SIZE + _maskSize;
+	uint8_t index = 0;
+	for (Property **p = _propertiesAry; *p != NULL && !any; ++p, ++index) {
+		uint8_t size;
+		const uint8_t *v = static_cast<const uint8_t *>((*p)->getCommittedStorage(&size));
+		any = mustWrite(index, offset, v, size, slot, valid);
+		offset += size;
+	}
+	if (!any) {
+		return;
+	}
+	// values and mask before the header: until the checksum is written the
+	// slot cannot be mistaken for the newest record. A mask byte is written
+	// after its eight values, so mustWrite() sees the same slot as above
+	uint16_t addr = slotAddr(slot);
+	uint8_t mask = 0;
+	offset = HEADER_SIZE + _maskSize;
+	index = 0;
+	for (Property **p = _propertiesAry; *p != NULL; ++p, ++index) {
+		uint8_t size;
+		const uint8_t *v = static_cast<const uint8_t *>((*p)->getCommittedStorage(&size));
+		if (mustWrite(index, offset, v, size, slot, valid)) {
+			mask |= 1 << (index % 8);
+			for (uint8_t j = 0; j < size; ++j) {
+				update(addr + offset + j, v[j]);
+			}
+		}
+		offset += size;
+		if (index % 8 == 7 || p[1] == NULL) {
+			update(addr + HEADER_SIZE + index / 8, mask);
+			mask = 0;
+		}
+	}
+	uint16_t seq = _sequence + 1;
+	update(addr, seq & 0xff);
+	update(addr + 1, seq >> 8);
+	uint16_t check = checksum(slot);
+	update(addr + _recordSize - TRAILER_SIZE, check & 0xff);
+	update(addr + _recordSize - TRAILER_SIZE + 1, check >> 8);
+	_slot = slot;
+	_sequence = seq;
+}
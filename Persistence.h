@@ -0,0 +1,113 @@
+/*
+  Persistence.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PERSISTENCE_H_
+#define PERSISTENCE_H_
+
+#include "PropertyMenu.h"
+
+///////////////////////////////////////////////////////////////////////////
+// EepromDevice
+///////////////////////////////////////////////////////////////////////////
+
+// Byte addressable non-volatile memory. Reads are cheap, a write costs
+// milliseconds and a cell wears out after ~100000 of them.
+class EepromDevice
+{
+public:
+	virtual ~EepromDevice();
+	virtual uint16_t getSize() const = 0;
+	virtual uint8_t read(uint16_t addr) const = 0;
+	virtual void write(uint16_t addr, uint8_t value) = 0;
+};
+
+#ifndef _WIN32
+// internal EEPROM of the AVR
+class AvrEeprom: public EepromDevice
+{
+public:
+	uint16_t getSize() const;
+	uint8_t read(uint16_t addr) const;
+	void write(uint16_t addr, uint8_t value);
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// PersistStore
+///////////////////////////////////////////////////////////////////////////
+
+// Saves the variables bound to a NULL terminated property array (those
+// with storage, see Property::getStorage()). The area is split in a ring
+// of slots and every save goes to the slot after the newest, so the wear
+// spreads over all of them. A record is
+//   sequence (2) | mask (1 bit per property) | values | checksum (2)
+// and holds only the values set in the mask: those that differ from their
+// newest saved copy, plus those whose newest copy is in the slot being
+// written or in the next one, so overwriting a slot never drops the last
+// copy of a value. A save with nothing to write writes nothing.
+// restore() loads every value from the newest valid record holding it, so
+// a save cut by a reset leaves the previous values in place, and clamps it
+// into the limits of its property. Up to 255 properties.
+class PersistStore
+{
+public:
+	enum {
+		HEADER_SIZE = 2,
+		TRAILER_SIZE = 2,
+		NO_SLOT = 0xff
+	};
+	PersistStore(EepromDevice *device, Property *propertiesAry[], uint16_t addr, uint16_t size);
+	uint16_t getRecordSize() const { return _recordSize; }
+	uint8_t getSlotCount() const { return _slotCount; }
+	uint8_t getCurrentSlot() const { return _slot; }
+	bool restore(); // false if no valid record, variables are left as they are
+	void save();
+	uint32_t getBytesWritten() const { return _bytesWritten; }
+	uint16_t getSaveCount() const { return _saveCount; }
+
+private:
+	enum {
+		VALID_SIZE = (NO_SLOT + 7) / 8
+	};
+	uint16_t slotAddr(uint8_t slot) const;
+	uint8_t nextSlot(uint8_t slot) const;
+	uint16_t readU16(uint16_t addr) const;
+	void update(uint16_t addr, uint8_t value);
+	bool hasValue(uint8_t slot, uint8_t index) const;
+	uint16_t checksum(uint8_t slot) const;
+	void scan(uint8_t *valid);
+	uint8_t findNewest(uint8_t index, const uint8_t *valid) const;
+	bool mustWrite(uint8_t index, uint16_t offset, const uint8_t *value, uint8_t size,
+		uint8_t slot, const uint8_t *valid) const;
+
+	EepromDevice *_device;
+	Property **_propertiesAry;
+	uint16_t _addr;
+	uint16_t _layout; // signature of the kinds and sizes of the properties
+	uint8_t _maskSize;
+	uint16_t _recordSize;
+	uint8_t _slotCount;
+	uint8_t _slot; // newest valid record, NO_SLOT if none
+	uint16_t _sequence;
+	uint16_t _saveCount;
+	uint32_t _bytesWritten;
+};
+
+#endif // PERSISTENCE_H_
@@ -19,6 +19,13 @@
 */
 
 #include "PropertyMenu.h"
+#include "ActionQueue.h"
+#include "ChangeTracker.h"
+#include "MenuTrace.h"
+#include "MenuFootprint.h"
+#if defined(_WIN32) && !defined(NDEBUG) && !defined(PROPERTY_MENU_CLOSED_PROPERTIES)
+#include <typeinfo>
+#endif
 
 const char SEL_LEFT = '[';
 const char SEL_RIGHT = ']';
@@ -30,6 +37,9 @@ const char SPACE = ' ';
 const char CURSOR = '>';
 const char REPLY_YES = 'Y';
 const char REPLY_NO = 'N';
+const char QUEUED = '.';
+const char PERCENT = '%';
+const char OVERFLOW_DIGIT = '*';
 const char PREV_MENU[] = "..";
 
 static void pad00Print(LCD *lcd, uint8_t n)
@@ -42,18 +52,18 @@ static void pad00Print(LCD *lcd, uint8_t n)
 	lcd->print(n);
 }
 
-static void padMulti0Print(LCD *lcd, uint16_t n, uint8_t width)
+static void padMulti0Print(LCD *lcd, uint32_t n, uint8_t width)
 {
 	assert(lcd != NULL);
-	uint16_t m = 10;
+	uint32_t m = 1;
 	for (uint8_t i = 1; i < width; ++i) {
+		m *= 10;
 		if (n < m) {
 			lcd->print('0');
 		}
-		m *= 10;
 	}
-	assert(n < m);
-	lcd->print(n);
+	assert(n / m < 10);
+	lcd->print(static_cast<unsigned long>(n));
 }
 
 template<typename T>
@@ -95,6 +105,12 @@ static void wrapIncrease(T *n, T low, T high)
 	}
 }
 
+// one byte of FNV-1a, as ShadowLCD::getFrameHash() and MenuIndex use
+static uint32_t hashAdd(uint32_t hash, uint8_t byte)
+{
+	return (hash ^ byte) * 16777619UL;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Screen
 ///////////////////////////////////////////////////////////////////////////
@@ -102,26 +118,121 @@ static void wrapIncrease(T *n, T low, T high)
 Screen::Screen(LCD *lcd, uint8_t cols, uint8_t rows)
 : _lcd(lcd),
 	_cols(cols),
-	_rows(rows)
+	_rows(rows),
+	_updating(false),
+	_paintPending(false)
 {
 	assert(_lcd != NULL);
 	assert(_cols > 0);
 	assert(_rows > 0);
+#ifdef PROPERTY_MENU_STATS
+	resetStats();
+#endif
 	_lcd->begin(cols, rows);
 }
 
+void Screen::beginUpdate()
+{
+	assert(!_updating);
+#ifdef PROPERTY_MENU_STATS
+	endCycle();
+#endif
+	_updating = true;
+	_paintPending = false;
+}
+
+bool Screen::endUpdate()
+{
+	assert(_updating);
+	_updating = false;
+	bool pending = _paintPending;
+	_paintPending = false;
+	return pending;
+}
+
+#ifdef PROPERTY_MENU_STATS
+uint16_t Screen::getAvgEventBytes() const
+{
+	return _stats.events > 0 ? static_cast<uint16_t>(_stats.eventBytes / _stats.events) : 0;
+}
+
+void Screen::resetStats()
+{
+	memset(&_stats, 0, sizeof(_stats));
+	_cycleBytes = 0;
+	_cycleCleared = false;
+	_cycleEvent = false;
+}
+
+void Screen::countSend(uint8_t value, uint8_t mode)
+{
+	if (mode == DATA) {
+		_stats.dataBytes++;
+	} else {
+		_stats.commands++;
+		if (value == LCD_CLEARDISPLAY) {
+			_stats.clears++;
+			_cycleCleared = true;
+		}
+	}
+	if (_cycleBytes < 0xffff) {
+		_cycleBytes++;
+	}
+}
+
+void Screen::endCycle()
+{
+	if (_cycleBytes > 0) {
+		if (_cycleCleared) {
+			_stats.fullPaints++;
+		} else {
+			_stats.partialPaints++;
+		}
+	}
+	if (_cycleEvent) {
+		_stats.events++;
+		_stats.eventBytes += _cycleBytes;
+		if (_cycleBytes > _stats.maxEventBytes) {
+			_stats.maxEventBytes = _cycleBytes;
+		}
+	}
+	_cycleBytes = 0;
+	_cycleCleared = false;
+	_cycleEvent = false;
+}
+#endif
+
 ///////////////////////////////////////////////////////////////////////////
 // Property
 ///////////////////////////////////////////////////////////////////////////
 
+#ifndef PROPERTY_MENU_CLOSED_PROPERTIES
 Property::Property(const __FlashStringHelper *name, uint8_t maxFocusParts)
 : _name(name),
 	_focusPart(0),
-	_maxFocusParts(maxFocusParts)
+	_maxFocusParts(maxFocusParts),
+	_kind(KIND_CUSTOM),
+	_flags(0),
+	_committedVar(NULL)
 {
 	assert(name != NULL);
 	assert(maxFocusParts > 0);
 }
+#endif
+
+Property::Property(const __FlashStringHelper *name, uint8_t maxFocusParts, Kind kind)
+: _name(name),
+	_focusPart(0),
+	_maxFocusParts(maxFocusParts),
+	_kind(kind),
+	_flags(0),
+	_committedVar(NULL)
+{
+	assert(name != NULL);
+	assert(maxFocusParts > 0);
+}
+
+ChangeTracker *Property::_tracker = NULL;
 
 Property::~Property()
 {
@@ -132,7 +243,63 @@ void Property::nextFocusPart()
 	_focusPart++;
 	if (_focusPart > _maxFocusParts) {
 		_focusPart = 0;
-		onExitEdit();
+		dispatchExitEdit();
+	}
+}
+
+bool Property::beginStage(uint8_t *shadow, uint8_t capacity)
+{
+	assert(shadow != NULL);
+	uint8_t size;
+	void *var = getStorage(&size);
+	if (var == NULL || size > capacity) {
+		return false;
+	}
+	memcpy(shadow, var, size);
+	if (!setStorage(shadow)) {
+		return false;
+	}
+	_committedVar = var;
+	return true;
+}
+
+void Property::endStage(bool commit)
+{
+	assert(isStaged());
+	uint8_t size;
+	const void *shadow = getStorage(&size);
+	void *var = _committedVar;
+	setStorage(var);
+	_committedVar = NULL;
+	if (commit && memcmp(var, shadow, size) != 0) {
+		memcpy(var, shadow, size);
+		markDirty();
+	}
+}
+
+bool Property::editInput(ButtonPress button)
+{
+	bool redraw = dispatchEditInput(button);
+	// enter only moves the focus, up and down change the value; staged
+	// values become dirty when committed
+	if (redraw && button != BUTTON_PRESS_ENTER && !isDirty() && !isStaged()) {
+		uint8_t size;
+		if (getStorage(&size) != NULL) {
+			markDirty();
+		}
+	}
+	return redraw;
+}
+
+void Property::markDirty()
+{
+	if (isDirty()) {
+		return;
+	}
+	// a property the tracker cannot list stays clean: the overflow makes the
+	// consumer rescan, and its next change is offered to the tracker again
+	if (_tracker == NULL || _tracker->markChanged(this)) {
+		_flags |= FLAG_DIRTY;
 	}
 }
 
@@ -144,7 +311,7 @@ void Property::paintLabel(LCD *lcd) const
 
 void Property::enterEdit()
 {
-	onEnterEdit();
+	dispatchEnterEdit();
 	_focusPart = 1;
 }
 
@@ -156,12 +323,24 @@ void Property::onExitEdit()
 {
 }
 
+void *Property::getCustomStorage(uint8_t *size) const
+{
+	assert(size != NULL);
+	*size = 0;
+	return NULL;
+}
+
+bool Property::setCustomStorage(void * /*var*/)
+{
+	return false;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // PropertyTime
 ///////////////////////////////////////////////////////////////////////////
 
 PropertyTime::PropertyTime(const __FlashStringHelper *name, PropertyTime::Time *var)
-: Property(name, 2),
+: Property(name, 2, KIND_TIME),
 	_var(var)
 {
 	assert(var != NULL);
@@ -226,7 +405,7 @@ bool PropertyTime::processEditInput(ButtonPress button)
 ///////////////////////////////////////////////////////////////////////////
 
 PropertyDate::PropertyDate(const __FlashStringHelper *name, PropertyDate::Date *var)
-: Property(name, 3),
+: Property(name, 3, KIND_DATE),
 	_var(var)
 {
 	assert(var != NULL);
@@ -325,7 +504,7 @@ const LimitWidth limitWidth[] = {
 };
 
 PropertyU16::PropertyU16(const __FlashStringHelper *name, uint16_t *var, uint16_t limitMin, uint16_t limitMax)
-: Property(name, 1),
+: Property(name, 1, KIND_U16),
 	_var(var),
 	_limitMin(limitMin),
 	_limitMax(limitMax)
@@ -369,12 +548,188 @@ bool PropertyU16::processEditInput(ButtonPress button)
 	return false;
 }
 
+///////////////////////////////////////////////////////////////////////////
+// PropertyIntBase
+///////////////////////////////////////////////////////////////////////////
+
+enum IntTypeCodes {
+	INT_TYPE_U8 = 0,
+	INT_TYPE_S8,
+	INT_TYPE_U16,
+	INT_TYPE_S16,
+	INT_TYPE_U32,
+	INT_TYPE_S32
+};
+
+PropertyIntBase::PropertyIntBase(const __FlashStringHelper *name, void *var, uint8_t typeCode,
+	uint32_t rawMin, uint32_t rawMax, uint8_t displayWidth)
+: Property(name, 1, KIND_INT),
+	_var(var),
+	_rawMin(rawMin),
+	_range(rawMax - rawMin),
+	_typeCode(typeCode),
+	_displayWidth(displayWidth),
+	_repeatCount(0),
+	_lastButton(BUTTON_PRESS_NONE)
+{
+	assert(var != NULL);
+	assert(typeCode <= INT_TYPE_S32);
+	assert(_range > 0);
+	clip(_var);
+}
+
+void PropertyIntBase::clip(void *var) const
+{
+	uint32_t raw = readRaw(var);
+	uint32_t rawMax = _rawMin + _range;
+	bool below = isSigned() ? static_cast<int32_t>(raw) < static_cast<int32_t>(_rawMin) : raw < _rawMin;
+	bool above = isSigned() ? static_cast<int32_t>(raw) > static_cast<int32_t>(rawMax) : raw > rawMax;
+	if (below) {
+		writeRaw(var, _rawMin);
+	} else if (above) {
+		writeRaw(var, rawMax);
+	}
+}
+
+void PropertyIntBase::setOffset(uint32_t offset)
+{
+	writeRaw(_rawMin + (offset < _range ? offset : _range));
+}
+
+uint32_t PropertyIntBase::readRaw(const void *var) const
+{
+	switch (_typeCode) {
+		case INT_TYPE_U8:
+			return *static_cast<const uint8_t *>(var);
+		case INT_TYPE_S8:
+			return static_cast<uint32_t>(static_cast<int32_t>(*static_cast<const int8_t *>(var)));
+		case INT_TYPE_U16:
+			return *static_cast<const uint16_t *>(var);
+		case INT_TYPE_S16:
+			return static_cast<uint32_t>(static_cast<int32_t>(*static_cast<const int16_t *>(var)));
+		case INT_TYPE_U32:
+			return *static_cast<const uint32_t *>(var);
+		default:
+			return static_cast<uint32_t>(*static_cast<const int32_t *>(var));
+	}
+}
+
+void PropertyIntBase::writeRaw(void *var, uint32_t raw) const
+{
+	switch (_typeCode) {
+		case INT_TYPE_U8:
+		case INT_TYPE_S8:
+			*static_cast<uint8_t *>(var) = static_cast<uint8_t>(raw);
+			break;
+		case INT_TYPE_U16:
+		case INT_TYPE_S16:
+			*static_cast<uint16_t *>(var) = static_cast<uint16_t>(raw);
+			break;
+		default:
+			*static_cast<uint32_t *>(var) = raw;
+			break;
+	}
+}
+
+uint32_t PropertyIntBase::currentStep() const
+{
+	uint32_t step = 1;
+	for (uint8_t n = _repeatCount / ACCEL_REPEATS; n > 0; --n) {
+		// never jump by more than a quarter of the range
+		if (step * 10 > _range / 4) {
+			break;
+		}
+		step *= 10;
+	}
+	return step;
+}
+
+void PropertyIntBase::stepUp(uint32_t step)
+{
+	uint32_t offset = readRaw() - _rawMin;
+	if (offset == _range) {
+		offset = 0;
+	} else if (_range - offset < step) {
+		offset = _range;
+	} else {
+		offset += step;
+	}
+	writeRaw(_rawMin + offset);
+}
+
+void PropertyIntBase::stepDown(uint32_t step)
+{
+	uint32_t offset = readRaw() - _rawMin;
+	if (offset == 0) {
+		offset = _range;
+	} else if (offset < step) {
+		offset = 0;
+	} else {
+		offset -= step;
+	}
+	writeRaw(_rawMin + offset);
+}
+
+void PropertyIntBase::paintEdit(LCD *lcd) const
+{
+	assert(lcd != NULL);
+	assert(getFocusPart() <= 1);
+
+	uint8_t focusPart = getFocusPart();
+	lcd->print(focusPart == 1 ? SEL_LEFT : SPACE);
+	uint32_t raw = readRaw();
+	uint8_t digits = _displayWidth;
+	if (isSigned() && static_cast<int32_t>(_rawMin) < 0) {
+		bool negative = static_cast<int32_t>(raw) < 0;
+		lcd->print(negative ? '-' : SPACE);
+		if (negative) {
+			raw = 0 - raw;
+		}
+		digits--;
+	}
+	padMulti0Print(lcd, raw, digits);
+	lcd->print(focusPart == 1 ? SEL_RIGHT : SPACE);
+}
+
+bool PropertyIntBase::processEditInput(ButtonPress button)
+{
+	assert(getFocusPart() == 1);
+	ButtonPress plain = repeatedButton(button);
+	if (plain == BUTTON_PRESS_DOWN || plain == BUTTON_PRESS_UP) {
+		// only auto-repeat accelerates: a new press is back to single steps
+		if (button != plain && plain == _lastButton) {
+			if (_repeatCount < 0xff) {
+				_repeatCount++;
+			}
+		} else {
+			_repeatCount = 0;
+			_lastButton = plain;
+		}
+		if (plain == BUTTON_PRESS_DOWN) {
+			stepDown(currentStep());
+		} else {
+			stepUp(currentStep());
+		}
+		return true;
+	} else if (button == BUTTON_PRESS_ENTER) {
+		nextFocusPart();
+		return true;
+	}
+	return false;
+}
+
+void PropertyIntBase::onEnterEdit()
+{
+	_repeatCount = 0;
+	_lastButton = BUTTON_PRESS_NONE;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // PropertyBool
 ///////////////////////////////////////////////////////////////////////////
 
 PropertyBool::PropertyBool(const __FlashStringHelper *name, bool *var)
-: Property(name, 1),
+: Property(name, 1, KIND_BOOL),
 	_var(var)
 {
 	assert(var != NULL);
@@ -410,14 +765,61 @@ bool PropertyBool::processEditInput(ButtonPress button)
 // PropertyAction
 ///////////////////////////////////////////////////////////////////////////
 
+ActionQueue *PropertyAction::_queue = NULL;
+
 PropertyAction::PropertyAction(const __FlashStringHelper *name, Callback callback)
-: Property(name, 1),
+: Property(name, 1, KIND_ACTION),
 	_callback(callback),
-	_confirm(false)
+	_step(NULL),
+	_confirm(false),
+	_state(STATE_IDLE),
+	_progress(0)
 {
 	assert(callback != NULL);
 }
 
+PropertyAction::PropertyAction(const __FlashStringHelper *name, ActionStep step)
+: Property(name, 1, KIND_ACTION),
+	_callback(NULL),
+	_step(step),
+	_confirm(false),
+	_state(STATE_IDLE),
+	_progress(0)
+{
+	assert(step != NULL);
+}
+
+bool PropertyAction::runStep()
+{
+	bool cancel = _state == STATE_CANCELLING;
+	uint8_t progress = _progress;
+	bool done = true;
+	if (_step != NULL) {
+		_state = cancel ? STATE_CANCELLING : STATE_RUNNING;
+		done = _step(&_progress, cancel) || cancel;
+	} else if (!cancel) {
+		_callback();
+	}
+	if (done) {
+		_state = STATE_IDLE;
+		_progress = 0;
+		requestRefresh();
+	} else if (_progress != progress) {
+		requestRefresh();
+	}
+	return done;
+}
+
+void PropertyAction::requestCancel()
+{
+	if (_state == STATE_QUEUED) {
+		_state = STATE_IDLE;
+	} else if (_state == STATE_RUNNING) {
+		_state = STATE_CANCELLING;
+	}
+	requestRefresh();
+}
+
 void PropertyAction::paintEdit(LCD *lcd) const
 {
 	assert(lcd != NULL);
@@ -428,6 +830,14 @@ void PropertyAction::paintEdit(LCD *lcd) const
 		lcd->print(SEL_LEFT);
 		lcd->print(_confirm ? REPLY_YES : REPLY_NO);
 		lcd->print(SEL_RIGHT);
+	} else if (_state == STATE_QUEUED) {
+		lcd->print(QUEUED);
+		lcd->print(QUEUED);
+		lcd->print(QUEUED);
+	} else if (_state != STATE_IDLE) {
+		// at most 99%: the action is over at 100
+		pad00Print(lcd, _progress < 100 ? _progress : 99);
+		lcd->print(PERCENT);
 	} else {
 		lcd->print(SPACE);
 		lcd->print(SPACE);
@@ -443,7 +853,15 @@ bool PropertyAction::processEditInput(ButtonPress button)
 		return true;
 	} else if (button == BUTTON_PRESS_ENTER) {
 		if (_confirm) {
-			_callback();
+			// confirming on a busy action cancels it
+			if (isBusy()) {
+				_queue->cancel(this);
+			} else if (_queue != NULL && _queue->post(this)) {
+				_state = STATE_QUEUED;
+			} else {
+				while (!runStep()) {
+				}
+			}
 		}
 		nextFocusPart();
 		return true;
@@ -456,6 +874,348 @@ void PropertyAction::onEnterEdit()
 	_confirm = false;
 }
 
+///////////////////////////////////////////////////////////////////////////
+// PropertyLive
+///////////////////////////////////////////////////////////////////////////
+
+PropertyLive::PropertyLive(const __FlashStringHelper *name, LiveGetter getter, uint8_t width)
+: Property(name, 1, KIND_LIVE),
+	_getter(getter),
+	_width(width)
+{
+	assert(getter != NULL);
+	assert(width > 0 && width <= MAX_WIDTH);
+	for (uint8_t i = 0; i < MAX_WIDTH; ++i) {
+		_shown[i] = SPACE;
+	}
+}
+
+void PropertyLive::format(char *text) const
+{
+	int32_t value = _getter();
+	bool negative = value < 0;
+	uint32_t n = negative ? 0 - static_cast<uint32_t>(value) : value;
+	int8_t i = _width - 1;
+	do {
+		text[i--] = '0' + n % 10;
+		n /= 10;
+	} while (n > 0 && i >= 0);
+	if (n > 0 || (negative && i < 0)) {
+		// does not fit the width
+		for (i = 0; i < _width; ++i) {
+			text[i] = OVERFLOW_DIGIT;
+		}
+		return;
+	}
+	if (negative) {
+		text[i--] = '-';
+	}
+	while (i >= 0) {
+		text[i--] = SPACE;
+	}
+}
+
+void PropertyLive::paintEdit(LCD *lcd) const
+{
+	assert(lcd != NULL);
+	format(_shown);
+	lcd->print(SPACE);
+	lcd->write(reinterpret_cast<const uint8_t *>(_shown), _width);
+	lcd->print(SPACE);
+}
+
+bool PropertyLive::processEditInput(ButtonPress /*button*/)
+{
+	return false;
+}
+
+uint8_t PropertyLive::paintChanges(LCD *lcd, uint8_t col, uint8_t row) const
+{
+	assert(lcd != NULL);
+	char text[MAX_WIDTH];
+	format(text);
+	uint8_t written = 0;
+	bool contiguous = false;
+	for (uint8_t i = 0; i < _width; ++i) {
+		if (text[i] == _shown[i]) {
+			contiguous = false;
+			continue;
+		}
+		// the lcd address auto-increments along a run of changes
+		if (!contiguous) {
+			lcd->setCursor(col + 1 + i, row);
+			contiguous = true;
+		}
+		lcd->write(static_cast<uint8_t>(text[i]));
+		_shown[i] = text[i];
+		++written;
+	}
+	return written;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Property dispatch
+///////////////////////////////////////////////////////////////////////////
+
+// Qualified calls on the built-in kinds are resolved at compile time and
+// can be inlined; only KIND_CUSTOM pays for the virtual call. Without
+// custom properties the default branches cannot be reached.
+
+#if defined(_WIN32) && !defined(NDEBUG) && !defined(PROPERTY_MENU_CLOSED_PROPERTIES)
+// false for a subclass of a built-in type, whose overrides the static
+// dispatch would skip; the PropertyInt instances cannot be told apart
+static bool isBuiltInType(const Property *p)
+{
+	const std::type_info &type = typeid(*p);
+	switch (p->getKind()) {
+		case Property::KIND_TIME:
+			return type == typeid(PropertyTime);
+		case Property::KIND_DATE:
+			return type == typeid(PropertyDate);
+		case Property::KIND_U16:
+			return type == typeid(PropertyU16);
+		case Property::KIND_BOOL:
+			return type == typeid(PropertyBool);
+		case Property::KIND_ACTION:
+			return type == typeid(PropertyAction);
+		case Property::KIND_LIVE:
+			return type == typeid(PropertyLive);
+		default:
+			return true;
+	}
+}
+#endif
+
+uint8_t Property::getEditKind() const
+{
+#ifndef PROPERTY_MENU_CLOSED_PROPERTIES
+	if ((_flags & FLAG_VIRTUAL) != 0) {
+		return KIND_CUSTOM;
+	}
+#if defined(_WIN32) && !defined(NDEBUG)
+	// a subclass of a built-in type must call dispatchVirtually()
+	assert(isBuiltInType(this));
+#endif
+#endif
+	return _kind;
+}
+
+void Property::paintValue(LCD *lcd) const
+{
+	switch (getEditKind()) {
+		case KIND_TIME:
+			static_cast<const PropertyTime *>(this)->PropertyTime::paintEdit(lcd);
+			break;
+		case KIND_DATE:
+			static_cast<const PropertyDate *>(this)->PropertyDate::paintEdit(lcd);
+			break;
+		case KIND_U16:
+			static_cast<const PropertyU16 *>(this)->PropertyU16::paintEdit(lcd);
+			break;
+		case KIND_BOOL:
+			static_cast<const PropertyBool *>(this)->PropertyBool::paintEdit(lcd);
+			break;
+		case KIND_ACTION:
+			static_cast<const PropertyAction *>(this)->PropertyAction::paintEdit(lcd);
+			break;
+		case KIND_INT:
+			static_cast<const PropertyIntBase *>(this)->PropertyIntBase::paintEdit(lcd);
+			break;
+		case KIND_LIVE:
+			static_cast<const PropertyLive *>(this)->PropertyLive::paintEdit(lcd);
+			break;
+		default:
+#ifdef PROPERTY_MENU_CLOSED_PROPERTIES
+			assert(false);
+#else
+			paintEdit(lcd);
+#endif
+			break;
+	}
+}
+
+bool Property::dispatchEditInput(ButtonPress button)
+{
+	// only PropertyIntBase tells auto-repeat from single presses
+	ButtonPress plain = repeatedButton(button);
+	switch (getEditKind()) {
+		case KIND_TIME:
+			return static_cast<PropertyTime *>(this)->PropertyTime::processEditInput(plain);
+		case KIND_DATE:
+			return static_cast<PropertyDate *>(this)->PropertyDate::processEditInput(plain);
+		case KIND_U16:
+			return static_cast<PropertyU16 *>(this)->PropertyU16::processEditInput(plain);
+		case KIND_BOOL:
+			return static_cast<PropertyBool *>(this)->PropertyBool::processEditInput(plain);
+		case KIND_ACTION:
+			return static_cast<PropertyAction *>(this)->PropertyAction::processEditInput(plain);
+		case KIND_INT:
+			return static_cast<PropertyIntBase *>(this)->PropertyIntBase::processEditInput(button);
+		case KIND_LIVE:
+			return false;
+		default:
+#ifdef PROPERTY_MENU_CLOSED_PROPERTIES
+			assert(false);
+			return false;
+#else
+			return processEditInput(plain);
+#endif
+	}
+}
+
+void *Property::getStorage(uint8_t *size) const
+{
+	assert(size != NULL);
+	switch (_kind) {
+		case KIND_TIME:
+			*size = sizeof(PropertyTime::Time);
+			return static_cast<const PropertyTime *>(this)->getVar();
+		case KIND_DATE:
+			*size = sizeof(PropertyDate::Date);
+			return static_cast<const PropertyDate *>(this)->getVar();
+		case KIND_U16:
+			*size = sizeof(uint16_t);
+			return static_cast<const PropertyU16 *>(this)->getVar();
+		case KIND_BOOL:
+			*size = sizeof(bool);
+			return static_cast<const PropertyBool *>(this)->getVar();
+		case KIND_INT:
+			*size = static_cast<const PropertyIntBase *>(this)->getVarSize();
+			return static_cast<const PropertyIntBase *>(this)->getVar();
+		case KIND_ACTION:
+		case KIND_LIVE:
+			*size = 0;
+			return NULL;
+		default:
+#ifdef PROPERTY_MENU_CLOSED_PROPERTIES
+			*size = 0;
+			return NULL;
+#else
+			return getCustomStorage(size);
+#endif
+	}
+}
+
+void Property::clipStorage(void *var) const
+{
+	assert(var != NULL);
+	switch (_kind) {
+		case KIND_TIME: {
+			PropertyTime::Time *v = static_cast<PropertyTime::Time *>(var);
+			if (v->hour > 23) {
+				v->hour = 23;
+			}
+			if (v->mins > 59) {
+				v->mins = 59;
+			}
+			break;
+		}
+		case KIND_DATE: {
+			PropertyDate::Date *v = static_cast<PropertyDate::Date *>(var);
+			clipValue<uint8_t>(&v->day, 1, 31);
+			clipValue<uint8_t>(&v->month, 1, 12);
+			if (v->year2000 > 99) {
+				v->year2000 = 99;
+			}
+			break;
+		}
+		case KIND_U16: {
+			const PropertyU16 *u = static_cast<const PropertyU16 *>(this);
+			clipValue(static_cast<uint16_t *>(var), u->getLimitMin(), u->getLimitMax());
+			break;
+		}
+		case KIND_BOOL: {
+			// any byte but 0 reads as true
+			bool *v = static_cast<bool *>(var);
+			*v = *reinterpret_cast<const uint8_t *>(v) != 0;
+			break;
+		}
+		case KIND_INT:
+			static_cast<const PropertyIntBase *>(this)->clip(var);
+			break;
+		default:
+			// custom values are the property's business
+			break;
+	}
+}
+
+void *Property::getCommittedStorage(uint8_t *size) const
+{
+	void *var = getStorage(size);
+	return isStaged() ? _committedVar : var;
+}
+
+bool Property::setStorage(void *var)
+{
+	assert(var != NULL);
+	switch (_kind) {
+		case KIND_TIME:
+			static_cast<PropertyTime *>(this)->setVar(static_cast<PropertyTime::Time *>(var));
+			return true;
+		case KIND_DATE:
+			static_cast<PropertyDate *>(this)->setVar(static_cast<PropertyDate::Date *>(var));
+			return true;
+		case KIND_U16:
+			static_cast<PropertyU16 *>(this)->setVar(static_cast<uint16_t *>(var));
+			return true;
+		case KIND_BOOL:
+			static_cast<PropertyBool *>(this)->setVar(static_cast<bool *>(var));
+			return true;
+		case KIND_INT:
+			static_cast<PropertyIntBase *>(this)->setVar(var);
+			return true;
+		case KIND_ACTION:
+		case KIND_LIVE:
+			return false;
+		default:
+#ifdef PROPERTY_MENU_CLOSED_PROPERTIES
+			return false;
+#else
+			return setCustomStorage(var);
+#endif
+	}
+}
+
+void Property::dispatchEnterEdit()
+{
+	switch (getEditKind()) {
+		case KIND_ACTION:
+			static_cast<PropertyAction *>(this)->PropertyAction::onEnterEdit();
+			break;
+		case KIND_INT:
+			static_cast<PropertyIntBase *>(this)->PropertyIntBase::onEnterEdit();
+			break;
+		case KIND_TIME:
+		case KIND_DATE:
+		case KIND_U16:
+		case KIND_BOOL:
+		case KIND_LIVE:
+			break;
+		default:
+			onEnterEdit();
+			break;
+	}
+}
+
+void Property::dispatchExitEdit()
+{
+	switch (getEditKind()) {
+		case KIND_DATE:
+			static_cast<PropertyDate *>(this)->PropertyDate::onExitEdit();
+			break;
+		case KIND_TIME:
+		case KIND_U16:
+		case KIND_BOOL:
+		case KIND_ACTION:
+		case KIND_INT:
+		case KIND_LIVE:
+			break;
+		default:
+			onExitEdit();
+			break;
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Page
 ///////////////////////////////////////////////////////////////////////////
@@ -475,7 +1235,9 @@ void Page::reset()
 void Page::paint(Screen *screen) const
 {
 	assert(screen != NULL);
+	TRACE_BEGIN(SCOPE_PAINT, MenuTrace::getPageId(this));
 	screen->getLcd()->clear();
+	TRACE_END(SCOPE_PAINT);
 }
 
 uint8_t Page::buttonInput(ButtonPress /*button*/, Screen * /*screen*/)
@@ -483,6 +1245,57 @@ uint8_t Page::buttonInput(ButtonPress /*button*/, Screen * /*screen*/)
 	return INVALID_LINE;
 }
 
+Page *Page::getChildPage(uint8_t /*line*/) const
+{
+	return NULL;
+}
+
+uint8_t Page::getLineCount() const
+{
+	return 0;
+}
+
+Property *Page::getProperty(uint8_t /*idx*/) const
+{
+	return NULL;
+}
+
+const __FlashStringHelper *Page::getLineName(uint8_t /*idx*/) const
+{
+	return NULL;
+}
+
+void Page::showLine(uint8_t /*line*/, uint8_t /*rows*/)
+{
+}
+
+uint16_t Page::getState() const
+{
+	return 0;
+}
+
+void Page::setState(uint16_t /*state*/)
+{
+}
+
+uint16_t Page::getContentHash() const
+{
+	return CONTENT_UNCACHEABLE;
+}
+
+void Page::refresh(Screen * /*screen*/)
+{
+}
+
+uint16_t Page::getPollPeriod() const
+{
+	return 0;
+}
+
+void Page::poll(Screen * /*screen*/)
+{
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // ScrollablePage
 ///////////////////////////////////////////////////////////////////////////
@@ -508,6 +1321,7 @@ void ScrollablePage::setMaxLines(uint8_t maxLines)
 void ScrollablePage::paint(Screen *screen) const
 {
 	assert(screen != NULL);
+	TRACE_BEGIN(SCOPE_PAINT, MenuTrace::getPageId(this));
 	LCD *lcd = screen->getLcd();
 	lcd->clear();
 	for (uint8_t i = 0; i < screen->getRows(); ++i) {
@@ -523,6 +1337,7 @@ void ScrollablePage::paint(Screen *screen) const
 		}
 	}
 	paintCursor(screen);
+	TRACE_END(SCOPE_PAINT);
 }
 
 uint8_t ScrollablePage::buttonInput(ButtonPress button, Screen *screen)
@@ -539,24 +1354,30 @@ uint8_t ScrollablePage::buttonInput(ButtonPress button, Screen *screen)
 			}
 			break;
 		case BUTTON_PRESS_DOWN:
+		case BUTTON_PRESS_HOLD_DOWN:
 			if (idx < _maxLines) {
 				if (_cursorRow < screen->getRows() - 1) {
 					_cursorRow++;
-					paintCursor(screen);
+					if (!screen->isPaintPending()) {
+						paintCursor(screen);
+					}
 				} else {
 					_topIndex++;
-					paint(screen);
+					repaint(screen);
 				}
 			}
 			break;
 		case BUTTON_PRESS_UP:
+		case BUTTON_PRESS_HOLD_UP:
 			if (getCurIdx() > 0) {
 				if (_cursorRow == 0) {
 					_topIndex--;
-					paint(screen);
+					repaint(screen);
 				} else {
 					_cursorRow--;
-					paintCursor(screen);
+					if (!screen->isPaintPending()) {
+						paintCursor(screen);
+					}
 				}
 			}
 			break;
@@ -566,6 +1387,36 @@ uint8_t ScrollablePage::buttonInput(ButtonPress button, Screen *screen)
 	return INVALID_LINE;
 }
 
+uint8_t ScrollablePage::getLineCount() const
+{
+	return _maxLines;
+}
+
+void ScrollablePage::showLine(uint8_t line, uint8_t rows)
+{
+	assert(line <= _maxLines);
+	assert(rows > 0);
+	if (line < rows) {
+		_topIndex = 0;
+		_cursorRow = line;
+	} else {
+		_topIndex = line - rows + 1;
+		_cursorRow = rows - 1;
+	}
+}
+
+uint16_t ScrollablePage::getState() const
+{
+	return (static_cast<uint16_t>(_topIndex) << 8) | _cursorRow;
+}
+
+void ScrollablePage::setState(uint16_t state)
+{
+	_topIndex = static_cast<uint8_t>(state >> 8);
+	_cursorRow = static_cast<uint8_t>(state);
+	assert(getCurIdx() <= _maxLines);
+}
+
 void ScrollablePage::paintCursor(Screen *screen) const
 {
 	assert(screen != NULL);
@@ -580,13 +1431,26 @@ void ScrollablePage::focusLine(uint8_t /*line*/)
 {
 }
 
+void ScrollablePage::repaint(Screen *screen) const
+{
+	assert(screen != NULL);
+	if (screen->isUpdating()) {
+		screen->deferPaint();
+	} else {
+		paint(screen);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // PropertyPage
 ///////////////////////////////////////////////////////////////////////////
 
 PropertyPage::PropertyPage(Property **propertiesAry)
 : _propertiesAry(propertiesAry),
-	_maxPropNameLen(0)
+	_maxPropNameLen(0),
+	_focusLine(INVALID_LINE),
+	_pollPeriod(0),
+	_staged(false)
 {
 	assert(propertiesAry != NULL);
 	assert(propertiesAry[0] != NULL);
@@ -608,7 +1472,41 @@ PropertyPage::PropertyPage(Property **propertiesAry)
 
 void PropertyPage::reset()
 {
+	if (_focusLine != INVALID_LINE) {
+		_propertiesAry[_focusLine]->cancelEdit();
+		endEdit(false);
+	}
+	_focusLine = INVALID_LINE;
+}
+
+void PropertyPage::cancelEdit(Screen *screen)
+{
+	assert(screen != NULL);
+	if (_focusLine == INVALID_LINE) {
+		return;
+	}
+	Property *p = _propertiesAry[_focusLine];
+	p->cancelEdit();
+	endEdit(false);
+	if (!screen->isPaintPending()) {
+		screen->getLcd()->setCursor(_maxPropNameLen + 2, getCursorRow());
+		p->paintValue(screen->getLcd());
+	}
+}
+
+void PropertyPage::endEdit(bool commit)
+{
+	assert(_focusLine != INVALID_LINE);
+	Property *p = _propertiesAry[_focusLine];
+	bool staged = p->isStaged();
+	if (staged) {
+		p->endStage(commit);
+	}
 	_focusLine = INVALID_LINE;
+	// an edit in place has changed the variable even when cancelled
+	if ((commit || !staged) && Property::getTracker() != NULL) {
+		Property::getTracker()->exitEdit();
+	}
 }
 
 uint8_t PropertyPage::buttonInput(ButtonPress button, Screen *screen)
@@ -620,13 +1518,22 @@ uint8_t PropertyPage::buttonInput(ButtonPress button, Screen *screen)
 	Property *p = _propertiesAry[_focusLine];
 	LCD *lcd = screen->getLcd();
 	assert(p->getFocusPart() != 0);
-	if (p->processEditInput(button)) {
-		screen->getLcd()->setCursor(_maxPropNameLen + 2, getCursorRow());
-		p->paintEdit(lcd);
+	if (button == BUTTON_PRESS_HOLD_ENTER && p->isStaged()) {
+		cancelEdit(screen);
+		return INVALID_LINE;
+	}
+	if (repeatedButton(button) == BUTTON_PRESS_NONE) {
+		return INVALID_LINE;
 	}
+	bool redraw = p->editInput(button);
 	bool hasFocus = p->getFocusPart() != 0;
 	if (!hasFocus) {
-		_focusLine = INVALID_LINE;
+		// commit first, the value painted must be the stored one
+		endEdit(true);
+	}
+	if (redraw && !screen->isPaintPending()) {
+		screen->getLcd()->setCursor(_maxPropNameLen + 2, getCursorRow());
+		p->paintValue(lcd);
 	}
 	return INVALID_LINE;
 }
@@ -637,17 +1544,119 @@ void PropertyPage::paintLine(uint8_t line, uint8_t row, Screen *screen) const
 	assert(screen != NULL);
 	Property *p = _propertiesAry[line];
 	if (p != NULL) {
+		TRACE_BEGIN(SCOPE_PAINT_LINE, line);
 		LCD *lcd = screen->getLcd();
 		lcd->setCursor(COL_CONTENTS, row);
 		p->paintLabel(lcd);
 		lcd->setCursor(_maxPropNameLen + 2, row);
-		p->paintEdit(lcd);
+		p->paintValue(lcd);
+		TRACE_END(SCOPE_PAINT_LINE);
+	}
+}
+
+uint16_t PropertyPage::getContentHash() const
+{
+	// FNV-1a over the edit focus and the values painted, a staged one
+	// from its shadow, folded to 16 bits
+	uint32_t hash = hashAdd(2166136261UL, _focusLine);
+	for (uint8_t i = 0; i < getMaxLines(); ++i) {
+		const Property *p = _propertiesAry[i];
+		uint8_t size;
+		const uint8_t *v = static_cast<const uint8_t *>(p->getStorage(&size));
+		int32_t live;
+		uint8_t actionState[2];
+		if (p->getKind() == Property::KIND_LIVE) {
+			live = static_cast<const PropertyLive *>(p)->getValue();
+			v = reinterpret_cast<const uint8_t *>(&live);
+			size = sizeof(live);
+		} else if (p->getKind() == Property::KIND_ACTION) {
+			const PropertyAction *action = static_cast<const PropertyAction *>(p);
+			actionState[0] = action->getState();
+			actionState[1] = action->getProgress();
+			v = actionState;
+			size = sizeof(actionState);
+		} else if (v == NULL) {
+			return CONTENT_UNCACHEABLE; // a custom property without storage
+		}
+		hash = hashAdd(hash, p->getFocusPart());
+		for (uint8_t j = 0; j < size; ++j) {
+			hash = hashAdd(hash, v[j]);
+		}
 	}
+	uint16_t folded = static_cast<uint16_t>(hash ^ (hash >> 16));
+	// kept apart from CONTENT_UNCACHEABLE
+	return folded == CONTENT_UNCACHEABLE ? CONTENT_UNCACHEABLE - 1 : folded;
+}
+
+void PropertyPage::refresh(Screen *screen)
+{
+	assert(screen != NULL);
+	LCD *lcd = screen->getLcd();
+	for (uint8_t i = 0; i < screen->getRows(); ++i) {
+		uint8_t idx = getTopIndex() + i;
+		if (idx == 0 || idx > getMaxLines()) {
+			continue;
+		}
+		Property *p = _propertiesAry[idx - 1];
+		if (p->needsRefresh()) {
+			p->clearRefresh();
+			lcd->setCursor(_maxPropNameLen + 2, i);
+			p->paintValue(lcd);
+		}
+	}
+}
+
+Property *PropertyPage::getProperty(uint8_t idx) const
+{
+	return idx < getMaxLines() ? _propertiesAry[idx] : NULL;
+}
+
+const __FlashStringHelper *PropertyPage::getLineName(uint8_t idx) const
+{
+	return idx < getMaxLines() ? _propertiesAry[idx]->getName() : NULL;
+}
+
+uint16_t PropertyPage::getPollPeriod() const
+{
+	return _pollPeriod;
+}
+
+void PropertyPage::poll(Screen *screen)
+{
+	assert(screen != NULL);
+	LCD *lcd = screen->getLcd();
+	for (uint8_t i = 0; i < screen->getRows(); ++i) {
+		uint8_t idx = getTopIndex() + i;
+		if (idx == 0 || idx > getMaxLines()) {
+			continue;
+		}
+		const Property *p = _propertiesAry[idx - 1];
+		if (p->getKind() == Property::KIND_LIVE) {
+			static_cast<const PropertyLive *>(p)->paintChanges(lcd, _maxPropNameLen + 2, i);
+		}
+	}
+}
+
+uint32_t PropertyPage::getDirtyMask() const
+{
+	uint32_t mask = 0;
+	for (uint8_t i = 0; i < getMaxLines() && i < 32; ++i) {
+		if (_propertiesAry[i]->isDirty()) {
+			mask |= static_cast<uint32_t>(1) << i;
+		}
+	}
+	return mask;
 }
 
 void PropertyPage::focusLine(uint8_t line)
 {
 	Property *p = _propertiesAry[line];
+	if (p->isReadOnly()) {
+		return;
+	}
+	if (_staged) {
+		p->beginStage(_stage.bytes, sizeof(_stage));
+	}
 	p->enterEdit();
 	_focusLine = line;
 }
@@ -691,6 +1700,24 @@ uint8_t MenuItemPage::buttonInput(ButtonPress button, Screen *screen)
 	return ScrollablePage::buttonInput(button, screen);
 }
 
+Page *MenuItemPage::getChildPage(uint8_t line) const
+{
+	if (line == 0 || line > getMaxLines()) {
+		return NULL;
+	}
+	return _menuItemAry[line - 1]->getPage();
+}
+
+const __FlashStringHelper *MenuItemPage::getLineName(uint8_t idx) const
+{
+	return idx < getMaxLines() ? _menuItemAry[idx]->getName() : NULL;
+}
+
+uint16_t MenuItemPage::getContentHash() const
+{
+	return 0; // labels only
+}
+
 void MenuItemPage::paintLine(uint8_t line, uint8_t row, Screen *screen) const
 {
 	assert(screen != NULL);
@@ -701,3 +1728,15 @@ void MenuItemPage::paintLine(uint8_t line, uint8_t row, Screen *screen) const
 		lcd->print(p->getName());
 	}
 }
+
+///////////////////////////////////////////////////////////////////////////
+// MenuFootprint
+///////////////////////////////////////////////////////////////////////////
+
+// here, where the tables are visible; AVR copies constants to RAM at startup
+uint16_t MenuFootprint::getStaticRam()
+{
+	// Property::_tracker, PropertyAction::_queue, MenuTrace::_active
+	return sizeof(ChangeTracker *) + sizeof(ActionQueue *) + sizeof(MenuTrace *) +
+		sizeof(PREV_MENU) + sizeof(limitWidth);
+}
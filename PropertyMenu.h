@@ -39,11 +39,41 @@
 #define PROGMEM
 #endif
 
+// Define PROPERTY_MENU_CLOSED_PROPERTIES when only the built-in property
+// types are used: editing is then dispatched on Property::Kind alone and
+// Property carries no vtable.
+#ifdef PROPERTY_MENU_CLOSED_PROPERTIES
+#define PROPERTY_VIRTUAL
+#define PROPERTY_PURE
+#else
+#define PROPERTY_VIRTUAL virtual
+#define PROPERTY_PURE = 0
+#endif
+
+// Define PROPERTY_MENU_STATS to have Screen count what painting costs, see
+// Screen::Stats.
+
 #define MakeFlashString(name, value) \
   static const char __##name[] PROGMEM = value; \
   const __FlashStringHelper *name = reinterpret_cast<const __FlashStringHelper *>(__##name);
 
 typedef void (*Callback)(void);
+// one slice of a long action: updates progress (0-100), true when finished;
+// called once more with cancel set if the user aborts it
+typedef bool (*ActionStep)(uint8_t *progress, bool cancel);
+// current reading shown by a PropertyLive
+typedef int32_t (*LiveGetter)(void);
+
+class ActionQueue;
+class ChangeTracker;
+
+typedef uint32_t (*ClockCallback)(void); // milliseconds, like millis()
+
+// true once now has reached deadline, robust to millis() wrap around
+inline bool timeReached(uint32_t now, uint32_t deadline)
+{
+	return static_cast<int32_t>(now - deadline) >= 0;
+}
 
 enum ButtonPress {
 	BUTTON_PRESS_NONE = -1,
@@ -52,9 +82,29 @@ enum ButtonPress {
 	BUTTON_PRESS_UP,
 	BUTTON_PRESS_ENTER,
 
+	// generated while a button is held down, see ButtonRepeater
+	BUTTON_PRESS_HOLD_DOWN, // auto-repeat
+	BUTTON_PRESS_HOLD_UP, // auto-repeat
+	BUTTON_PRESS_HOLD_ENTER, // long press, sent once
+
 	BUTTON_PRESS_COUNT
 };
 
+// plain press equivalent of an auto-repeat, BUTTON_PRESS_NONE for a long press
+inline ButtonPress repeatedButton(ButtonPress button)
+{
+	switch (button) {
+		case BUTTON_PRESS_HOLD_DOWN:
+			return BUTTON_PRESS_DOWN;
+		case BUTTON_PRESS_HOLD_UP:
+			return BUTTON_PRESS_UP;
+		case BUTTON_PRESS_HOLD_ENTER:
+			return BUTTON_PRESS_NONE;
+		default:
+			return button;
+	}
+}
+
 
 ///////////////////////////////////////////////////////////////////////////
 // Screen
@@ -69,10 +119,58 @@ public:
 	uint8_t getCols() const { return _cols; }
 	uint8_t getRows() const { return _rows; }
 
+	// between beginUpdate() and endUpdate() full repaints requested by pages
+	// are coalesced: the caller repaints once if endUpdate() returns true
+	void beginUpdate();
+	bool endUpdate();
+	bool isUpdating() const { return _updating; }
+	bool isPaintPending() const { return _paintPending; }
+	void deferPaint() { _paintPending = true; }
+
+#ifdef PROPERTY_MENU_STATS
+	// A cycle runs from one beginUpdate() to the next, so that it includes
+	// the paints of MenuNavigator and Page::refresh() following the input.
+	// Cycles sending anything are full paints if they cleared the display,
+	// partial otherwise, and input events if a button was dispatched.
+	struct Stats {
+		uint32_t commands; // clears included
+		uint32_t dataBytes;
+		uint32_t clears;
+		uint32_t fullPaints;
+		uint32_t partialPaints;
+		uint32_t events;
+		uint32_t eventBytes; // commands and data bytes of the input events
+		uint16_t maxEventBytes;
+	};
+	const Stats &getStats() const { return _stats; }
+	uint16_t getAvgEventBytes() const;
+	void resetStats();
+	// called by the LCD for every byte sent, as ShadowLCD does
+	void countSend(uint8_t value, uint8_t mode);
+#endif
+	// called by the dispatchers before Page::buttonInput()
+#ifdef PROPERTY_MENU_STATS
+	void countEvent() { _cycleEvent = true; }
+#else
+	void countEvent() {}
+#endif
+
 private:
+#ifdef PROPERTY_MENU_STATS
+	void endCycle();
+#endif
+
 	LCD *_lcd;
 	uint8_t _cols;
 	uint8_t _rows;
+	bool _updating;
+	bool _paintPending;
+#ifdef PROPERTY_MENU_STATS
+	Stats _stats;
+	uint16_t _cycleBytes;
+	bool _cycleCleared;
+	bool _cycleEvent;
+#endif
 };
 
 ///////////////////////////////////////////////////////////////////////////
@@ -82,25 +180,100 @@ private:
 class Property
 {
 public:
-	virtual ~Property();
+	// built-in types are dispatched statically, KIND_CUSTOM goes through the
+	// vtable; there are no custom properties with CLOSED_PROPERTIES
+	enum Kind {
+#ifndef PROPERTY_MENU_CLOSED_PROPERTIES
+		KIND_CUSTOM = 0,
+#endif
+		KIND_TIME = 1,
+		KIND_DATE,
+		KIND_U16,
+		KIND_BOOL,
+		KIND_ACTION,
+		KIND_INT,
+		KIND_LIVE
+	};
+	PROPERTY_VIRTUAL ~Property();
 	const __FlashStringHelper *getName() const { return _name; }
+	uint8_t getKind() const { return _kind; }
+	bool isReadOnly() const { return _kind == KIND_LIVE; }
 	uint8_t getFocusPart() const { return _focusPart; }
+	uint8_t getMaxFocusParts() const { return _maxFocusParts; }
 	void nextFocusPart();
 	void paintLabel(LCD *lcd) const;
 	void enterEdit();
-
-	virtual void onEnterEdit();
-	virtual void onExitEdit();
-	virtual void paintEdit(LCD *lcd) const = 0;
-	virtual bool processEditInput(ButtonPress button) = 0; // true if it needs redraw
+	void paintValue(LCD *lcd) const;
+	bool editInput(ButtonPress button); // true if it needs redraw, button may be an auto-repeat
+	// bound variable and its size in bytes, NULL for properties without one
+	void *getStorage(uint8_t *size) const;
+	// binds another variable of the same type, false if not supported
+	bool setStorage(void *var);
+	// clamps a value laid out as getStorage() at var into the limits of
+	// the property, for values that did not come from editing
+	void clipStorage(void *var) const;
+	// staged editing: the value is edited in shadow, which must hold
+	// getStorage() bytes, and written back to the variable only on commit
+	bool beginStage(uint8_t *shadow, uint8_t capacity);
+	void endStage(bool commit);
+	bool isStaged() const { return _committedVar != NULL; }
+	// variable with the committed value, for persistence, snapshots and
+	// host reads:
+	// the bound one, or the one behind the shadow while staged
+	void *getCommittedStorage(uint8_t *size) const;
+	void cancelEdit() { _focusPart = 0; } // leaves editing without onExitEdit()
+	// value shown changed without input, cleared by PropertyPage::refresh()
+	bool needsRefresh() const { return (_flags & FLAG_REFRESH) != 0; }
+	void clearRefresh() { _flags &= ~FLAG_REFRESH; }
+	void requestRefresh() { _flags |= FLAG_REFRESH; }
+	// value edited since the last ChangeTracker::flush() and listed by it
+	bool isDirty() const { return (_flags & FLAG_DIRTY) != 0; }
+	void clearDirty() { _flags &= ~FLAG_DIRTY; }
+	static void setTracker(ChangeTracker *tracker) { _tracker = tracker; }
+	static ChangeTracker *getTracker() { return _tracker; }
+	void markDirty(); // for values changed other than by editing
+
+	PROPERTY_VIRTUAL void onEnterEdit();
+	PROPERTY_VIRTUAL void onExitEdit();
+	PROPERTY_VIRTUAL void paintEdit(LCD *lcd) const PROPERTY_PURE;
+	PROPERTY_VIRTUAL bool processEditInput(ButtonPress button) PROPERTY_PURE; // true if it needs redraw, button is never a HOLD
+	PROPERTY_VIRTUAL void *getCustomStorage(uint8_t *size) const;
+	PROPERTY_VIRTUAL bool setCustomStorage(void *var);
 
 protected:
+#ifndef PROPERTY_MENU_CLOSED_PROPERTIES
 	Property(const __FlashStringHelper *name, uint8_t maxFocusParts);
+#endif
+	Property(const __FlashStringHelper *name, uint8_t maxFocusParts, Kind kind);
+#ifndef PROPERTY_MENU_CLOSED_PROPERTIES
+	// A subclass of a built-in type that overrides paintEdit(),
+	// processEditInput(), onEnterEdit() or onExitEdit() must call this in
+	// its constructor, otherwise the built-in versions are called directly
+	// and the overrides are silently skipped. The Windows debug build
+	// asserts on subclasses that do not call it.
+	void dispatchVirtually() { _flags |= FLAG_VIRTUAL; }
+#endif
 
 private:
+	enum {
+		FLAG_REFRESH = 0x01,
+		FLAG_DIRTY = 0x02,
+		FLAG_VIRTUAL = 0x04
+	};
+	static ChangeTracker *_tracker;
+
+	// kind that selects paintEdit() and the other editing methods
+	uint8_t getEditKind() const;
+	bool dispatchEditInput(ButtonPress button);
+	void dispatchEnterEdit();
+	void dispatchExitEdit();
+
 	const __FlashStringHelper *_name;
 	uint8_t _focusPart;
 	uint8_t _maxFocusParts;
+	uint8_t _kind;
+	uint8_t _flags;
+	void *_committedVar; // NULL unless staged
 };
 
 
@@ -108,6 +281,8 @@ private:
 // PropertyTime
 ///////////////////////////////////////////////////////////////////////////
 
+// Edited through static dispatch, see Property::dispatchVirtually() before
+// subclassing.
 class PropertyTime: public Property
 {
 public:
@@ -116,6 +291,8 @@ public:
 		uint8_t mins;
 	};
 	PropertyTime(const __FlashStringHelper *name, Time *var);
+	Time *getVar() const { return _var; }
+	void setVar(Time *var) { _var = var; }
 	void paintEdit(LCD *lcd) const;
 	bool processEditInput(ButtonPress button);
 
@@ -128,6 +305,8 @@ private:
 // PropertyDate
 ///////////////////////////////////////////////////////////////////////////
 
+// Edited through static dispatch, see Property::dispatchVirtually() before
+// subclassing.
 class PropertyDate: public Property
 {
 public:
@@ -137,6 +316,8 @@ public:
 		uint8_t day;
 	};
 	PropertyDate(const __FlashStringHelper *name, Date *var);
+	Date *getVar() const { return _var; }
+	void setVar(Date *var) { _var = var; }
 	void onExitEdit();
 	void paintEdit(LCD *lcd) const;
 	bool processEditInput(ButtonPress button);
@@ -150,10 +331,16 @@ private:
 // PropertyU16
 ///////////////////////////////////////////////////////////////////////////
 
+// Edited through static dispatch, see Property::dispatchVirtually() before
+// subclassing.
 class PropertyU16: public Property
 {
 public:
 	PropertyU16(const __FlashStringHelper *name, uint16_t *var, uint16_t limitMin, uint16_t limitMax);
+	uint16_t *getVar() const { return _var; }
+	void setVar(uint16_t *var) { _var = var; }
+	uint16_t getLimitMin() const { return _limitMin; }
+	uint16_t getLimitMax() const { return _limitMax; }
 	void paintEdit(LCD *lcd) const;
 	bool processEditInput(ButtonPress button);
 
@@ -164,14 +351,127 @@ private:
 	uint8_t _displayWidth;
 };
 
+///////////////////////////////////////////////////////////////////////////
+// PropertyInt
+///////////////////////////////////////////////////////////////////////////
+
+// number of decimal digits of N, evaluated at compile time (0 for N == 0)
+template<unsigned long N>
+struct DecimalDigits {
+	enum { value = 1 + DecimalDigits<N / 10>::value };
+};
+
+template<>
+struct DecimalDigits<0> {
+	enum { value = 0 };
+};
+
+template<typename T> struct IntTypeCode;
+template<> struct IntTypeCode<uint8_t> { enum { value = 0 }; };
+template<> struct IntTypeCode<int8_t> { enum { value = 1 }; };
+template<> struct IntTypeCode<uint16_t> { enum { value = 2 }; };
+template<> struct IntTypeCode<int16_t> { enum { value = 3 }; };
+template<> struct IntTypeCode<uint32_t> { enum { value = 4 }; };
+template<> struct IntTypeCode<int32_t> { enum { value = 5 }; };
+
+// absolute value of V as unsigned long, also for the most negative value;
+// the sign test is skipped for unsigned T so that it does not warn
+template<typename T, T V>
+struct IntMagnitude {
+	static const bool NEGATIVE = (IntTypeCode<T>::value & 1) != 0 && static_cast<long>(V) < 0;
+	static const unsigned long value = NEGATIVE ?
+		static_cast<unsigned long>(-(static_cast<long>(V) + 1)) + 1 : static_cast<unsigned long>(V);
+};
+
+// Type-erased implementation shared by every PropertyInt instantiation, so
+// that each new integer type costs only a constructor. Values are handled
+// as their offset from the lower limit, which fits an uint32_t for all
+// supported types. Edited through static dispatch, see
+// Property::dispatchVirtually() before subclassing.
+class PropertyIntBase: public Property
+{
+public:
+	enum {
+		ACCEL_REPEATS = 8 // auto-repeats before the step grows tenfold
+	};
+	void *getVar() const { return _var; }
+	void setVar(void *var) { _var = var; }
+	uint8_t getVarSize() const { return 1 << (_typeCode >> 1); }
+	// value as distance from the lower limit, in 0..getRange()
+	uint32_t getRange() const { return _range; }
+	uint32_t getOffset() const { return readRaw() - _rawMin; }
+	// the same for a value laid out as getVar() at var
+	uint32_t getOffset(const void *var) const { return readRaw(var) - _rawMin; }
+	void setOffset(uint32_t offset);
+	void clip(void *var) const; // var clamped into the limits
+	// lower limit as stored in the raw uint32_t, sign extended if signed
+	uint32_t getRawMin() const { return _rawMin; }
+	bool isSigned() const { return (_typeCode & 1) != 0; }
+	void paintEdit(LCD *lcd) const;
+	bool processEditInput(ButtonPress button);
+	void onEnterEdit();
+
+protected:
+	PropertyIntBase(const __FlashStringHelper *name, void *var, uint8_t typeCode,
+		uint32_t rawMin, uint32_t rawMax, uint8_t displayWidth);
+
+private:
+	uint32_t readRaw() const { return readRaw(_var); }
+	uint32_t readRaw(const void *var) const;
+	void writeRaw(uint32_t raw) { writeRaw(_var, raw); }
+	void writeRaw(void *var, uint32_t raw) const;
+	uint32_t currentStep() const;
+	void stepUp(uint32_t step);
+	void stepDown(uint32_t step);
+
+	void *_var;
+	uint32_t _rawMin;
+	uint32_t _range;
+	uint8_t _typeCode;
+	uint8_t _displayWidth;
+	uint8_t _repeatCount;
+	uint8_t _lastButton;
+};
+
+// Integer property for 8/16/32-bit, signed and unsigned variables with
+// limits known at compile time. Holding a button accelerates the step (1,
+// 10, 100...), so wide ranges are crossed quickly; single presses always
+// step by one.
+template<typename T, T LimitMin, T LimitMax>
+class PropertyInt: public PropertyIntBase
+{
+public:
+	static const bool NEGATIVE = IntMagnitude<T, LimitMin>::NEGATIVE;
+	static const unsigned long MAGNITUDE_MIN = IntMagnitude<T, LimitMin>::value;
+	static const unsigned long MAGNITUDE_MAX = IntMagnitude<T, LimitMax>::value;
+	static const uint8_t DIGITS = 1 + DecimalDigits<
+		((MAGNITUDE_MIN > MAGNITUDE_MAX) ? MAGNITUDE_MIN : MAGNITUDE_MAX) / 10>::value;
+	static const uint8_t DISPLAY_WIDTH = DIGITS + (NEGATIVE ? 1 : 0);
+
+	PropertyInt(const __FlashStringHelper *name, T *var)
+	: PropertyIntBase(name, var, IntTypeCode<T>::value,
+		static_cast<uint32_t>(static_cast<int32_t>(LimitMin)),
+		static_cast<uint32_t>(static_cast<int32_t>(LimitMax)),
+		DISPLAY_WIDTH)
+	{
+	}
+
+private:
+	typedef char limitsMustBeOrdered[(LimitMin < LimitMax) ? 1 : -1];
+};
+
 ///////////////////////////////////////////////////////////////////////////
 // PropertyBool
 ///////////////////////////////////////////////////////////////////////////
 
+// Edited through static dispatch, see Property::dispatchVirtually() before
+// subclassing.
 class PropertyBool: public Property
 {
 public:
 	PropertyBool(const __FlashStringHelper *name, bool *var);
+	bool *getVar() const { return _var; }
+	void setVar(bool *var) { _var = var; }
 	void paintEdit(LCD *lcd) const;
 	bool processEditInput(ButtonPress button);
 private:
@@ -183,16 +483,67 @@ private:
 // PropertyAction
 ///////////////////////////////////////////////////////////////////////////
 
+// Edited through static dispatch, see Property::dispatchVirtually() before
+// subclassing.
 class PropertyAction: public Property
 {
 public:
+	enum State {
+		STATE_IDLE,
+		STATE_QUEUED,
+		STATE_RUNNING,
+		STATE_CANCELLING
+	};
 	PropertyAction(const __FlashStringHelper *name, Callback callback);
+	PropertyAction(const __FlashStringHelper *name, ActionStep step);
+	// with a queue confirmed actions run after the confirmation is painted
+	static void setQueue(ActionQueue *queue) { _queue = queue; }
+	uint8_t getState() const { return _state; }
+	uint8_t getProgress() const { return _progress; }
+	bool isBusy() const { return _state != STATE_IDLE; }
+	bool runStep(); // true when the action is over
+	void requestCancel();
 	void paintEdit(LCD *lcd) const;
 	bool processEditInput(ButtonPress button);
 	void onEnterEdit();
 private:
+	static ActionQueue *_queue;
+
 	Callback _callback;
+	ActionStep _step;
 	bool _confirm;
+	uint8_t _state;
+	uint8_t _progress;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// PropertyLive
+///////////////////////////////////////////////////////////////////////////
+
+// Read-only value taken from a getter (temperature, RSSI, uptime...),
+// right aligned in a fixed width. It cannot be focused; PropertyPage::poll()
+// repaints only the characters that differ from the last painted text.
+// Edited through static dispatch, see Property::dispatchVirtually() before
+// subclassing.
+class PropertyLive: public Property
+{
+public:
+	enum {
+		MAX_WIDTH = 11 // "-2147483648"
+	};
+	PropertyLive(const __FlashStringHelper *name, LiveGetter getter, uint8_t width);
+	int32_t getValue() const { return _getter(); }
+	void paintEdit(LCD *lcd) const;
+	bool processEditInput(ButtonPress button);
+	// value painted by paintEdit() at col, returns the characters written
+	uint8_t paintChanges(LCD *lcd, uint8_t col, uint8_t row) const;
+
+private:
+	void format(char *text) const;
+
+	LiveGetter _getter;
+	uint8_t _width;
+	mutable char _shown[MAX_WIDTH];
 };
 
 ///////////////////////////////////////////////////////////////////////////
@@ -205,12 +556,38 @@ public:
 	enum {
 		INVALID_LINE = 0xff
 	};
+	enum {
+		CONTENT_UNCACHEABLE = 0xffff // content hash of pages FrameCache must not keep
+	};
 	Page();
 	virtual ~Page();
 	virtual void reset();
 	virtual void paint(Screen *screen) const;
 	// INVALID_LINE if staying in the same page, else the number of last line selected when returning to parent
 	virtual uint8_t buttonInput(ButtonPress button, Screen *screen);
+	// page opened by a line returned from buttonInput(), NULL if none
+	virtual Page *getChildPage(uint8_t line) const;
+	// lines selectable in the page, getChildPage() takes 1..getLineCount()
+	virtual uint8_t getLineCount() const;
+	// property shown at idx (0 based), NULL if none
+	virtual Property *getProperty(uint8_t idx) const;
+	// label of the line at idx (0 based), NULL if none
+	virtual const __FlashStringHelper *getLineName(uint8_t idx) const;
+	// moves the cursor to line (as returned by buttonInput()) and scrolls
+	// it into view, without painting
+	virtual void showLine(uint8_t line, uint8_t rows);
+	// scroll/cursor position, saved by MenuNavigator while a child is open
+	virtual uint16_t getState() const;
+	virtual void setState(uint16_t state);
+	// changes whenever something painted by the page may look different;
+	// CONTENT_UNCACHEABLE, the default, when the page cannot tell
+	virtual uint16_t getContentHash() const;
+	// repaints what changed without input, called by the main loop
+	virtual void refresh(Screen *screen);
+	// ms between poll() calls while the page is shown, 0 if never
+	virtual uint16_t getPollPeriod() const;
+	// repaints values that change by themselves, called by the main loop
+	virtual void poll(Screen *screen);
 };
 
 
@@ -230,13 +607,21 @@ public:
 	uint8_t getCursorRow() const { return _cursorRow; }
 	uint8_t getMaxLines() const { return _maxLines; }
 	uint8_t getCurIdx() const { return _topIndex + _cursorRow; }
+	uint8_t getTopIndex() const { return _topIndex; }
 	void setMaxLines(uint8_t maxLines);
+	uint8_t getLineCount() const;
+	void showLine(uint8_t line, uint8_t rows);
 	void paint(Screen *screen) const;
 	uint8_t buttonInput(ButtonPress button, Screen *screen);
+	uint16_t getState() const;
+	void setState(uint16_t state);
 	void paintCursor(Screen *screen) const;
 	virtual void paintLine(uint8_t line, uint8_t row, Screen *screen) const = 0;
 	virtual void focusLine(uint8_t line);
 
+protected:
+	void repaint(Screen *screen) const;
+
 private:
 	uint8_t _maxLines;
 	uint8_t _topIndex;
@@ -251,16 +636,44 @@ private:
 class PropertyPage: public ScrollablePage
 {
 public:
+	enum {
+		STAGE_SIZE = 4 // largest built-in value, bigger ones are edited in place
+	};
 	explicit PropertyPage(Property *propertiesAry[]);
+	// with staged edits a value is written to its variable only when the
+	// property leaves focus, all at once; HOLD_ENTER discards the edit
+	void setStaged(bool staged) { _staged = staged; }
+	void cancelEdit(Screen *screen);
 	void reset();
 	uint8_t buttonInput(ButtonPress button, Screen *screen);
 	void paintLine(uint8_t line, uint8_t row, Screen *screen) const;
 	void focusLine(uint8_t line);
+	uint8_t getFocusLine() const { return _focusLine; } // INVALID_LINE if not editing
+	Property *getProperty(uint8_t idx) const;
+	const __FlashStringHelper *getLineName(uint8_t idx) const;
+	uint16_t getContentHash() const;
+	void refresh(Screen *screen);
+	// visible PropertyLive values are polled every periodMs, 0 disables it
+	void setPollPeriod(uint16_t periodMs) { _pollPeriod = periodMs; }
+	uint16_t getPollPeriod() const;
+	void poll(Screen *screen);
+	// bit n set if the n-th property is dirty, for the first 32 properties
+	uint32_t getDirtyMask() const;
 
 private:
 	Property **_propertiesAry;
 	uint8_t _maxPropNameLen;
 	uint8_t _focusLine;
+	uint16_t _pollPeriod;
+	bool _staged;
+	// shadow of the staged value, aligned for any built-in variable
+	union {
+		uint8_t bytes[STAGE_SIZE];
+		uint16_t u16;
+		uint32_t u32;
+	} _stage;
+
+	void endEdit(bool commit);
 };
 
 
@@ -290,7 +703,10 @@ class MenuItemPage: public ScrollablePage
 public:
 	explicit MenuItemPage(MenuItem *menuItemAry[]);
 	uint8_t buttonInput(ButtonPress button, Screen *screen);
+	Page *getChildPage(uint8_t line) const;
+	const __FlashStringHelper *getLineName(uint8_t idx) const;
 	void paintLine(uint8_t line, uint8_t row, Screen *screen) const;
+	uint16_t getContentHash() const;
 
 private:
 	MenuItem **_menuItemAry;
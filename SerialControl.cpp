@@ -0,0 +1,442 @@
+/*
+  SerialControl.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SerialControl.h"
+#include "ChangeTracker.h"
+
+const char ITEM_SEPARATOR = ';';
+const char VALUE_SEPARATOR = '=';
+const char ID_PREFIX = '#';
+#ifdef PROPERTY_MENU_STATS
+static const char STATS_FRAME[] = "!stats";
+static const char RESET_FRAME[] = "!reset";
+#endif
+
+static const char *findChar(const char *begin, const char *end, char c)
+{
+	while (begin != end && *begin != c) {
+		++begin;
+	}
+	return begin;
+}
+
+// decimal number at *p, which is moved past it
+static bool parseNumber(const char **p, const char *end, uint32_t *value)
+{
+	const char *s = *p;
+	uint32_t v = 0;
+	while (s != end && *s >= '0' && *s <= '9') {
+		uint8_t digit = *s - '0';
+		if (v > (0xffffffffUL - digit) / 10) {
+			return false;
+		}
+		v = v * 10 + digit;
+		++s;
+	}
+	if (s == *p) {
+		return false;
+	}
+	*p = s;
+	*value = v;
+	return true;
+}
+
+static bool parseChar(const char **p, const char *end, char c)
+{
+	if (*p == end || **p != c) {
+		return false;
+	}
+	++*p;
+	return true;
+}
+
+static int8_t hexDigit(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+static void print00(Print *out, uint8_t n)
+{
+	if (n < 10) {
+		out->print('0');
+	}
+	out->print(n);
+}
+
+// writes value into the storage of p, true if it was different
+static bool store(Property *p, const void *value, uint8_t size)
+{
+	uint8_t varSize;
+	void *var = p->getStorage(&varSize);
+	assert(var != NULL && varSize == size);
+	if (memcmp(var, value, size) == 0) {
+		return false;
+	}
+	memcpy(var, value, size);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// ByteSource
+///////////////////////////////////////////////////////////////////////////
+
+ByteSource::~ByteSource()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+// SerialControl
+///////////////////////////////////////////////////////////////////////////
+
+SerialControl::SerialControl(ByteSource *in, Print *out, const MenuIndex *index, char *line, uint8_t size)
+: _in(in),
+	_out(out),
+	_index(index),
+	_line(line),
+	_size(size),
+	_length(0),
+	_overflowed(false),
+	_changed(0),
+	_frames(0)
+{
+	assert(in != NULL);
+	assert(out != NULL);
+	assert(index != NULL);
+	assert(line != NULL);
+	assert(size > 0);
+#ifdef PROPERTY_MENU_STATS
+	_screen = NULL;
+#endif
+}
+
+uint8_t SerialControl::poll()
+{
+	uint8_t changed = 0;
+	int c;
+	while ((c = _in->read()) >= 0) {
+		if (c == '\r') {
+			continue;
+		}
+		if (c == '\n') {
+			if (_overflowed) {
+				printError(0, F("overflow"));
+			} else if (_length > 0) {
+				changed += process();
+			}
+			_length = 0;
+			_overflowed = false;
+		} else if (_length < _size) {
+			_line[_length++] = static_cast<char>(c);
+		} else {
+			_overflowed = true;
+		}
+	}
+	return changed;
+}
+
+uint8_t SerialControl::process()
+{
+	const char *end = _line + _length;
+	_frames++;
+#ifdef PROPERTY_MENU_STATS
+	if (processStats()) {
+		return 0;
+	}
+#endif
+	// first pass checks every item, nothing is written on error
+	uint8_t item = 1;
+	for (const char *p = _line; p < end; p = findChar(p, end, ITEM_SEPARATOR) + 1, ++item) {
+		const char *itemEnd = findChar(p, end, ITEM_SEPARATOR);
+		const char *eq = findChar(p, itemEnd, VALUE_SEPARATOR);
+		Property *prop = resolve(p, eq);
+		if (prop == NULL) {
+			printError(item, F("unknown"));
+			return 0;
+		}
+		if (eq == itemEnd) {
+			continue;
+		}
+		uint8_t size;
+		if (prop->getStorage(&size) == NULL) {
+			printError(item, F("readonly"));
+			return 0;
+		}
+		if (prop->getFocusPart() != 0) {
+			printError(item, F("busy"));
+			return 0;
+		}
+		if (!setValue(prop, eq + 1, itemEnd, false)) {
+			printError(item, F("value"));
+			return 0;
+		}
+	}
+	_out->print(F("OK"));
+	_changed = 0;
+	char separator = ' ';
+	for (const char *p = _line; p < end; p = findChar(p, end, ITEM_SEPARATOR) + 1) {
+		const char *itemEnd = findChar(p, end, ITEM_SEPARATOR);
+		const char *eq = findChar(p, itemEnd, VALUE_SEPARATOR);
+		Property *prop = resolve(p, eq);
+		if (eq != itemEnd) {
+			setValue(prop, eq + 1, itemEnd, true);
+		} else {
+			_out->print(separator);
+			separator = ITEM_SEPARATOR;
+			printValue(prop);
+		}
+	}
+	_out->print('\n');
+	if (_changed > 0 && Property::getTracker() != NULL) {
+		Property::getTracker()->flush();
+	}
+	return _changed;
+}
+
+#ifdef PROPERTY_MENU_STATS
+// true if the frame was a statistics one
+bool SerialControl::processStats()
+{
+	if (_screen == NULL || _line[0] != '!') {
+		return false;
+	}
+	if (_length == sizeof(RESET_FRAME) - 1 && memcmp(_line, RESET_FRAME, _length) == 0) {
+		_screen->resetStats();
+		_out->print(F("OK\n"));
+		return true;
+	}
+	if (_length != sizeof(STATS_FRAME) - 1 || memcmp(_line, STATS_FRAME, _length) != 0) {
+		return false;
+	}
+	const Screen::Stats &s = _screen->getStats();
+	const uint32_t values[] = {
+		s.commands, s.dataBytes, s.clears, s.fullPaints, s.partialPaints,
+		s.events, s.eventBytes, s.maxEventBytes, _screen->getAvgEventBytes()
+	};
+	_out->print(F("OK"));
+	char separator = ' ';
+	for (uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+		_out->print(separator);
+		separator = ITEM_SEPARATOR;
+		_out->print(static_cast<unsigned long>(values[i]));
+	}
+	_out->print('\n');
+	return true;
+}
+#endif
+
+Property *SerialControl::resolve(const char *begin, const char *end) const
+{
+	if (begin != end && *begin == ID_PREFIX) {
+		uint32_t id = 0;
+		for (const char *p = begin + 1; p != end; ++p) {
+			int8_t digit = hexDigit(*p);
+			if (digit < 0 || p - begin > 8) {
+				return NULL;
+			}
+			id = (id << 4) | digit;
+		}
+		return _index->findProperty(id);
+	}
+	return _index->findProperty(MenuIndex::hashPath(begin, end));
+}
+
+bool SerialControl::setValue(Property *p, const char *begin, const char *end, bool apply)
+{
+	const char *s = begin;
+	bool changed = false;
+	switch (p->getKind()) {
+		case Property::KIND_BOOL: {
+			uint32_t n;
+			if (!parseNumber(&s, end, &n) || s != end || n > 1) {
+				return false;
+			}
+			bool v = n != 0;
+			changed = apply && store(p, &v, sizeof(v));
+			break;
+		}
+		case Property::KIND_TIME: {
+			uint32_t hour;
+			uint32_t mins;
+			if (!parseNumber(&s, end, &hour) || !parseChar(&s, end, ':')
+				|| !parseNumber(&s, end, &mins) || s != end || hour > 23 || mins > 59) {
+				return false;
+			}
+			PropertyTime::Time v = *static_cast<PropertyTime *>(p)->getVar();
+			v.hour = static_cast<uint8_t>(hour);
+			v.mins = static_cast<uint8_t>(mins);
+			changed = apply && store(p, &v, sizeof(v));
+			break;
+		}
+		case Property::KIND_DATE: {
+			uint32_t day;
+			uint32_t month;
+			uint32_t year;
+			if (!parseNumber(&s, end, &day) || !parseChar(&s, end, '/')
+				|| !parseNumber(&s, end, &month) || !parseChar(&s, end, '/')
+				|| !parseNumber(&s, end, &year) || s != end
+				|| day < 1 || day > 31 || month < 1 || month > 12 || year < 2000 || year > 2099) {
+				return false;
+			}
+			PropertyDate::Date v = *static_cast<PropertyDate *>(p)->getVar();
+			v.day = static_cast<uint8_t>(day);
+			v.month = static_cast<uint8_t>(month);
+			v.year2000 = static_cast<uint8_t>(year - 2000);
+			changed = apply && store(p, &v, sizeof(v));
+			break;
+		}
+		case Property::KIND_U16: {
+			PropertyU16 *u = static_cast<PropertyU16 *>(p);
+			uint32_t n;
+			if (!parseNumber(&s, end, &n) || s != end || n < u->getLimitMin() || n > u->getLimitMax()) {
+				return false;
+			}
+			uint16_t v = static_cast<uint16_t>(n);
+			changed = apply && store(p, &v, sizeof(v));
+			break;
+		}
+		case Property::KIND_INT: {
+			PropertyIntBase *i = static_cast<PropertyIntBase *>(p);
+			bool negative = parseChar(&s, end, '-');
+			uint32_t magnitude;
+			if (!parseNumber(&s, end, &magnitude) || s != end) {
+				return false;
+			}
+			if (i->isSigned() ? magnitude > (negative ? 0x80000000UL : 0x7fffffffUL)
+				: negative && magnitude != 0) {
+				return false;
+			}
+			// offset from the limit in modular arithmetic, as PropertyIntBase does
+			uint32_t raw = negative ? 0 - magnitude : magnitude;
+			uint32_t offset = raw - i->getRawMin();
+			if (offset > i->getRange()) {
+				return false;
+			}
+			if (apply && i->getOffset() != offset) {
+				i->setOffset(offset);
+				changed = true;
+			}
+			break;
+		}
+		case Property::KIND_ACTION:
+		case Property::KIND_LIVE:
+			return false;
+		default: {
+			uint8_t size;
+			uint8_t *var = static_cast<uint8_t *>(p->getStorage(&size));
+			if (end - begin != 2 * size) {
+				return false;
+			}
+			for (uint8_t j = 0; j < size; ++j, s += 2) {
+				int8_t hi = hexDigit(s[0]);
+				int8_t lo = hexDigit(s[1]);
+				if (hi < 0 || lo < 0) {
+					return false;
+				}
+				uint8_t v = (hi << 4) | lo;
+				if (apply && var[j] != v) {
+					var[j] = v;
+					changed = true;
+				}
+			}
+			break;
+		}
+	}
+	if (changed) {
+		p->markDirty();
+		p->requestRefresh();
+		_changed++;
+	}
+	return true;
+}
+
+void SerialControl::printValue(const Property *p)
+{
+	// the host sees committed values, not those of a staged edit
+	uint8_t size;
+	const void *var = p->getCommittedStorage(&size);
+	switch (p->getKind()) {
+		case Property::KIND_BOOL:
+			_out->print(*static_cast<const bool *>(var) ? '1' : '0');
+			break;
+		case Property::KIND_TIME: {
+			const PropertyTime::Time *v = static_cast<const PropertyTime::Time *>(var);
+			print00(_out, v->hour);
+			_out->print(':');
+			print00(_out, v->mins);
+			break;
+		}
+		case Property::KIND_DATE: {
+			const PropertyDate::Date *v = static_cast<const PropertyDate::Date *>(var);
+			print00(_out, v->day);
+			_out->print('/');
+			print00(_out, v->month);
+			_out->print('/');
+			_out->print(2000 + v->year2000);
+			break;
+		}
+		case Property::KIND_U16:
+			_out->print(*static_cast<const uint16_t *>(var));
+			break;
+		case Property::KIND_INT: {
+			const PropertyIntBase *i = static_cast<const PropertyIntBase *>(p);
+			uint32_t raw = i->getRawMin() + i->getOffset(var);
+			if (i->isSigned()) {
+				_out->print(static_cast<long>(static_cast<int32_t>(raw)));
+			} else {
+				_out->print(static_cast<unsigned long>(raw));
+			}
+			break;
+		}
+		case Property::KIND_LIVE:
+			_out->print(static_cast<long>(static_cast<const PropertyLive *>(p)->getValue()));
+			break;
+		case Property::KIND_ACTION:
+			_out->print(static_cast<const PropertyAction *>(p)->getState());
+			break;
+		default: {
+			const uint8_t *bytes = static_cast<const uint8_t *>(var);
+			for (uint8_t j = 0; j < size; ++j) {
+				if (bytes[j] < 0x10) {
+					_out->print('0');
+				}
+				_out->print(bytes[j], HEX);
+			}
+			break;
+		}
+	}
+}
+
+void SerialControl::printError(uint8_t item, const __FlashStringHelper *reason)
+{
+	_out->print(F("ERR "));
+	_out->print(item);
+	_out->print(' ');
+	_out->print(reason);
+	_out->print('\n');
+}
@@ -0,0 +1,109 @@
+/*
+  SerialControl.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SERIAL_CONTROL_H_
+#define SERIAL_CONTROL_H_
+
+#include "PropertyMenu.h"
+#include "MenuIndex.h"
+#ifndef _WIN32
+#include "Stream.h"
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// ByteSource
+///////////////////////////////////////////////////////////////////////////
+
+class ByteSource
+{
+public:
+	virtual ~ByteSource();
+	virtual int read() = 0; // next byte, -1 if none is waiting
+};
+
+#ifndef _WIN32
+// hardware or software serial port
+class StreamSource: public ByteSource
+{
+public:
+	explicit StreamSource(Stream *stream) : _stream(stream) {}
+	int read() { return _stream->read(); }
+
+private:
+	Stream *_stream;
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// SerialControl
+///////////////////////////////////////////////////////////////////////////
+
+// Line protocol to read and write many properties in one round trip.
+// A frame is one line of items separated by ';', each item a path as in
+// MenuIndex ("Recordings/Time start") or '#' and the ID in hex, followed
+// by '=' and a value to set it:
+//   Settings/Time=12:30;Settings/Date=01/02/2013;Recordings/Id
+// and the reply is "OK" and the values of the items read, in order:
+//   OK 3
+// or "ERR <item> <reason>". Items are all checked before any is written,
+// so a frame is applied entirely or not at all. Values set are flagged
+// for Page::refresh() and notified to the ChangeTracker in one batch, so
+// the screen is updated once per frame.
+//   bool 0/1   time HH:MM   date DD/MM/YYYY   numbers decimal
+//   custom properties: their storage in hex
+// With PROPERTY_MENU_STATS and a screen set, the frame "!stats" is replied
+// with the Screen::Stats, in declaration order and then the average bytes
+// per event, and "!reset" clears them.
+class SerialControl
+{
+public:
+	SerialControl(ByteSource *in, Print *out, const MenuIndex *index, char *line, uint8_t size);
+	// handles the frames received so far, returns the values changed
+	uint8_t poll();
+	uint16_t getFrameCount() const { return _frames; }
+#ifdef PROPERTY_MENU_STATS
+	void setScreen(Screen *screen) { _screen = screen; }
+#endif
+
+private:
+	uint8_t process();
+#ifdef PROPERTY_MENU_STATS
+	bool processStats();
+#endif
+	Property *resolve(const char *begin, const char *end) const;
+	bool setValue(Property *p, const char *begin, const char *end, bool apply);
+	void printValue(const Property *p);
+	void printError(uint8_t item, const __FlashStringHelper *reason);
+
+	ByteSource *_in;
+	Print *_out;
+	const MenuIndex *_index;
+	char *_line;
+	uint8_t _size;
+	uint8_t _length;
+	bool _overflowed;
+	uint8_t _changed;
+	uint16_t _frames;
+#ifdef PROPERTY_MENU_STATS
+	Screen *_screen;
+#endif
+};
+
+#endif // SERIAL_CONTROL_H_
@@ -0,0 +1,149 @@
+/*
+  ShadowLCD.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ShadowLCD.h"
+#include "MenuTrace.h"
+
+///////////////////////////////////////////////////////////////////////////
+// ShadowLCD
+///////////////////////////////////////////////////////////////////////////
+
+ShadowLCD::ShadowLCD(LCD *out, char *frame, uint16_t frameSize)
+: _out(out),
+	_frame(frame),
+	_frameSize(frameSize),
+	_col(0),
+	_row(0)
+{
+	assert(frame != NULL);
+	_cols = 0;
+	_numlines = 0;
+#ifdef PROPERTY_MENU_STATS
+	_statsScreen = NULL;
+#endif
+	resetCounters();
+}
+
+void ShadowLCD::resetCounters()
+{
+	memset(&_counters, 0, sizeof(_counters));
+}
+
+uint32_t ShadowLCD::getBusTimeUs(const Counters &counters)
+{
+	uint32_t slow = counters.clears + counters.homes;
+	return slow * CLEAR_US + (counters.commands - slow) * COMMAND_US
+		+ counters.dataBytes * DATA_US;
+}
+
+uint32_t ShadowLCD::getFrameHash() const
+{
+	uint32_t hash = 2166136261UL;
+	for (uint16_t i = 0; i < getFrameSize(); ++i) {
+		hash = (hash ^ static_cast<uint8_t>(_frame[i])) * 16777619UL;
+	}
+	return hash;
+}
+
+void ShadowLCD::begin(uint8_t cols, uint8_t rows, uint8_t charsize)
+{
+	assert(static_cast<uint16_t>(cols) * rows <= _frameSize);
+	_cols = cols;
+	_numlines = rows;
+	clearFrame();
+	if (_out != NULL) {
+		_out->begin(cols, rows, charsize);
+	}
+}
+
+void ShadowLCD::blit(const char *frame)
+{
+	assert(frame != NULL);
+	TRACE_BEGIN(SCOPE_FLUSH, 0);
+	for (uint8_t r = 0; r < _numlines; ++r) {
+		const char *src = frame + r * _cols;
+		const char *dst = _frame + r * _cols;
+		for (uint8_t c = 0; c < _cols; ++c) {
+			if (src[c] != dst[c]) {
+				if (_row != r || _col != c) {
+					setCursor(c, r);
+				}
+				write(static_cast<uint8_t>(src[c]));
+			}
+		}
+	}
+	TRACE_END(SCOPE_FLUSH);
+}
+
+void ShadowLCD::clearFrame()
+{
+	memset(_frame, ' ', getFrameSize());
+	_col = 0;
+	_row = 0;
+}
+
+void ShadowLCD::send(uint8_t value, uint8_t mode)
+{
+#ifdef PROPERTY_MENU_STATS
+	if (_statsScreen != NULL) {
+		_statsScreen->countSend(value, mode);
+	}
+#endif
+	if (mode != DATA) {
+		_counters.commands++;
+	}
+	if (mode == DATA) {
+		_counters.dataBytes++;
+		if (_col < _cols && _row < _numlines) {
+			_frame[_row * _cols + _col] = static_cast<char>(value);
+		}
+		_col++;
+		if (_out != NULL) {
+			_out->write(value);
+		}
+	} else if (value == LCD_CLEARDISPLAY) {
+		_counters.clears++;
+		clearFrame();
+		if (_out != NULL) {
+			_out->clear();
+		}
+	} else if (value == LCD_RETURNHOME) {
+		_counters.homes++;
+		_col = 0;
+		_row = 0;
+		if (_out != NULL) {
+			_out->home();
+		}
+	} else if (value & LCD_SETDDRAMADDR) {
+		// inverse of the row offsets used by LCD::setCursor()
+		_counters.cursorMoves++;
+		uint8_t addr = value & ~LCD_SETDDRAMADDR;
+		uint8_t split = (_cols == 16 && _numlines == 4) ? 0x10 : 0x14;
+		_row = addr >= 0x40 ? 1 : 0;
+		_col = addr - (_row ? 0x40 : 0x00);
+		if (_numlines > 2 && _col >= split) {
+			_row += 2;
+			_col -= split;
+		}
+		if (_out != NULL) {
+			_out->setCursor(_col, _row);
+		}
+	}
+}
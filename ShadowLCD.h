@@ -0,0 +1,86 @@
+/*
+  ShadowLCD.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SHADOW_LCD_H_
+#define SHADOW_LCD_H_
+
+#include "PropertyMenu.h"
+
+///////////////////////////////////////////////////////////////////////////
+// ShadowLCD
+///////////////////////////////////////////////////////////////////////////
+
+// LCD decorator keeping a copy of the display contents, which the hardware
+// cannot read back. Every command and data byte is decoded in send() and
+// forwarded to the output LCD, if any: without one it is a headless display.
+// Traffic is counted to measure what painting costs on the LCD bus.
+class ShadowLCD: public LCD
+{
+public:
+	// HD44780 execution times
+	enum {
+		CLEAR_US = 1520, // clear and home
+		COMMAND_US = 37,
+		DATA_US = 41
+	};
+	struct Counters {
+		uint32_t commands; // all of them, clears and cursor moves included
+		uint32_t clears;
+		uint32_t homes;
+		uint32_t cursorMoves;
+		uint32_t dataBytes;
+	};
+	// frame holds cols * rows characters of the size later passed to begin()
+	ShadowLCD(LCD *out, char *frame, uint16_t frameSize);
+	void begin(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
+	LCD *getOutput() const { return _out; }
+	void setOutput(LCD *out) { _out = out; }
+	uint8_t getCols() const { return _cols; }
+	uint8_t getRows() const { return _numlines; }
+	const char *getFrame() const { return _frame; }
+	uint16_t getFrameSize() const { return static_cast<uint16_t>(_cols) * _numlines; }
+	char getChar(uint8_t col, uint8_t row) const { return _frame[row * _cols + col]; }
+	uint32_t getFrameHash() const; // FNV-1a of the frame
+	// brings the display to frame, writing only the cells that differ
+	void blit(const char *frame);
+	const Counters &getCounters() const { return _counters; }
+	void resetCounters();
+	static uint32_t getBusTimeUs(const Counters &counters);
+#ifdef PROPERTY_MENU_STATS
+	// screen whose Screen::Stats count the traffic, NULL for none
+	void setStatsScreen(Screen *screen) { _statsScreen = screen; }
+#endif
+
+private:
+	void send(uint8_t value, uint8_t mode);
+	void clearFrame();
+
+	LCD *_out;
+	char *_frame;
+	uint16_t _frameSize;
+	uint8_t _col;
+	uint8_t _row;
+	Counters _counters;
+#ifdef PROPERTY_MENU_STATS
+	Screen *_statsScreen;
+#endif
+};
+
+#endif // SHADOW_LCD_H_
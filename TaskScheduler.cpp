@@ -0,0 +1,130 @@
+/*
+  TaskScheduler.cpp - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "TaskScheduler.h"
+
+///////////////////////////////////////////////////////////////////////////
+// TaskScheduler
+///////////////////////////////////////////////////////////////////////////
+
+TaskScheduler::TaskScheduler(ClockCallback clock)
+: _clock(clock),
+	_count(0)
+{
+	assert(clock != NULL);
+	for (uint8_t i = 0; i < MAX_TASKS; ++i) {
+		_tasks[i].callback = NULL;
+	}
+}
+
+TaskScheduler::TaskId TaskScheduler::add(Callback callback, uint32_t periodMs, uint32_t delayMs)
+{
+	assert(callback != NULL);
+	for (TaskId id = 0; id < MAX_TASKS; ++id) {
+		Task &task = _tasks[id];
+		if (task.callback == NULL) {
+			task.callback = callback;
+			task.period = periodMs;
+			task.deadline = _clock() + delayMs;
+			schedule(id);
+			return id;
+		}
+	}
+	return INVALID_TASK;
+}
+
+void TaskScheduler::remove(TaskId id)
+{
+	if (id >= MAX_TASKS || _tasks[id].callback == NULL) {
+		return;
+	}
+	for (uint8_t pos = 0; pos < _count; ++pos) {
+		if (_order[pos] == id) {
+			unschedule(pos);
+			break;
+		}
+	}
+	_tasks[id].callback = NULL;
+}
+
+uint32_t TaskScheduler::getTimeToNext(uint32_t now) const
+{
+	if (_count == 0) {
+		return WAIT_FOREVER;
+	}
+	uint32_t deadline = _tasks[_order[0]].deadline;
+	return timeReached(now, deadline) ? 0 : deadline - now;
+}
+
+uint8_t TaskScheduler::runDue(uint32_t budgetMs)
+{
+	uint32_t start = _clock();
+	uint8_t ran = 0;
+	while (_count > 0) {
+		uint32_t now = _clock();
+		TaskId id = _order[0];
+		Task &task = _tasks[id];
+		if (!timeReached(now, task.deadline)) {
+			break;
+		}
+		if (ran > 0 && now - start >= budgetMs) {
+			break;
+		}
+		// reschedule before calling, the task may add or remove tasks
+		Callback callback = task.callback;
+		unschedule(0);
+		if (task.period > 0) {
+			task.deadline += task.period;
+			// after a stall skip the missed runs instead of bursting
+			if (timeReached(now, task.deadline)) {
+				task.deadline = now + task.period;
+			}
+			schedule(id);
+		} else {
+			task.callback = NULL;
+		}
+		callback();
+		++ran;
+	}
+	return ran;
+}
+
+void TaskScheduler::schedule(TaskId id)
+{
+	assert(_count < MAX_TASKS);
+	uint32_t deadline = _tasks[id].deadline;
+	uint8_t pos = _count;
+	// ties keep insertion order so equal periods take turns
+	while (pos > 0 && !timeReached(deadline, _tasks[_order[pos - 1]].deadline)) {
+		_order[pos] = _order[pos - 1];
+		--pos;
+	}
+	_order[pos] = id;
+	++_count;
+}
+
+void TaskScheduler::unschedule(uint8_t pos)
+{
+	assert(pos < _count);
+	--_count;
+	for (uint8_t i = pos; i < _count; ++i) {
+		_order[i] = _order[i + 1];
+	}
+}
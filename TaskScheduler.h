@@ -0,0 +1,71 @@
+/*
+  TaskScheduler.h - Arduino lcd menu with property editing library
+  Written by Yuri Valentini <yuroller [at] gmail.com>
+  Copyright (c) 2013 Yuri Valentini, All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TASK_SCHEDULER_H_
+#define TASK_SCHEDULER_H_
+
+#include "PropertyMenu.h"
+
+///////////////////////////////////////////////////////////////////////////
+// TaskScheduler
+///////////////////////////////////////////////////////////////////////////
+
+// Cooperative background jobs sharing the menu loop. Tasks live in a
+// fixed table and are kept sorted by deadline, so finding the next one
+// to run or to sleep for is O(1). A task must return quickly: long work
+// should be split across calls, like PropertyAction steps.
+class TaskScheduler
+{
+public:
+	enum {
+		MAX_TASKS = 8,
+		INVALID_TASK = 0xff
+	};
+	enum {
+		WAIT_FOREVER = 0xffffffffUL // no deadline, also used by InputSource
+	};
+	typedef uint8_t TaskId;
+
+	explicit TaskScheduler(ClockCallback clock);
+	// first run after delayMs, then every periodMs; period 0 runs once
+	TaskId add(Callback callback, uint32_t periodMs, uint32_t delayMs = 0);
+	void remove(TaskId id);
+	uint8_t getCount() const { return _count; }
+	uint32_t getTimeToNext(uint32_t now) const; // WAIT_FOREVER if none
+	// runs due tasks, earliest first, until budgetMs has elapsed; at
+	// least one due task runs so a small budget cannot starve them
+	uint8_t runDue(uint32_t budgetMs);
+
+private:
+	struct Task {
+		Callback callback;
+		uint32_t period;
+		uint32_t deadline;
+	};
+	void schedule(TaskId id); // inserts by deadline
+	void unschedule(uint8_t pos);
+
+	ClockCallback _clock;
+	Task _tasks[MAX_TASKS];
+	TaskId _order[MAX_TASKS]; // ids of the active tasks, earliest first
+	uint8_t _count;
+};
+
+#endif // TASK_SCHEDULER_H_
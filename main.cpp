@@ -1,14 +1,37 @@
 #include "PropertyMenu.h"
+#include "MenuRunner.h"
+#include "MenuNavigator.h"
+#include "ShadowLCD.h"
+#include "FrameCache.h"
+#include "ChangeTracker.h"
+#include "Persistence.h"
+#include "MenuSnapshot.h"
+#include "MenuIndex.h"
+#include "SerialControl.h"
+#include "MenuTrace.h"
+#include "MenuFootprint.h"
 #include "LCDWin.h"
-
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#include <conio.h>
+#include "ConsoleInput.h"
+#include "FileEeprom.h"
+#include "MappedFile.h"
+#include "PipePort.h"
+#include "KeyReplay.h"
+#include "MicroBench.h"
+#include "ChromeTrace.h"
+#include "GoldenFrames.h"
+#include "MenuFuzzer.h"
+#include "QueueStress.h"
+#include "SchedulerCheck.h"
+#include "SerialCheck.h"
+#include "FilePrint.h"
+#include "HeapTracker.h"
+#include <stdio.h>
 
 
 // labels
 MakeFlashString(LBL_TIME, "Time");
 MakeFlashString(LBL_DATE, "Date");
+MakeFlashString(LBL_UPTIME, "Uptime");
 MakeFlashString(LBL_ID, "Id");
 MakeFlashString(LBL_ACTIVE, "Active");
 MakeFlashString(LBL_PROGRAM, "Program");
@@ -26,9 +49,19 @@ PropertyDate::Date clockDate;
 PropertyTime clockProp(LBL_TIME, &clockTime);
 PropertyDate dateProp(LBL_DATE, &clockDate); 
 
+static ClockCallback uptimeClock = consoleMillis;
+
+static int32_t uptimeSeconds()
+{
+	return uptimeClock() / 1000;
+}
+
+PropertyLive uptimeProp(LBL_UPTIME, uptimeSeconds, 6);
+
 Property *settingsProperties[] = {
 	&clockProp,
 	&dateProp,
+	&uptimeProp,
 	NULL
 };
 
@@ -49,7 +82,7 @@ static void recordingApply()
 
 PropertyU16 idProp(LBL_ID, &id, 0, 9);
 PropertyBool activeProp(LBL_ACTIVE, &active);
-PropertyU16 programProp(LBL_PROGRAM, &program, 1, 999);
+PropertyInt<uint16_t, 1, 999> programProp(LBL_PROGRAM, &program);
 PropertyDate dateStartProp(LBL_DATE, &dateStart);
 PropertyTime timeStartProp(LBL_TIME_START, &timeStart);
 PropertyTime timeEndProp(LBL_TIME_END, &timeEnd);
@@ -84,6 +117,62 @@ MenuItem *mainMenuItems[] = {
 
 MenuItemPage mainMenuPage(mainMenuItems);
 
+// footprint of the menu above, see MenuFootprint
+#define MENU_OBJECTS(X) \
+	X(clockTime) X(clockDate) X(clockProp) X(dateProp) X(uptimeProp) \
+	X(settingsProperties) X(settingsPropPage) \
+	X(id) X(active) X(program) X(dateStart) X(timeStart) X(timeEnd) X(weekly) \
+	X(idProp) X(activeProp) X(programProp) X(dateStartProp) X(timeStartProp) \
+	X(timeEndProp) X(weeklyProp) X(recordingApplyProp) \
+	X(recordingProperties) X(recordingPropPage) \
+	X(menuSettingsItem) X(menuRecordingItem) X(mainMenuItems) X(mainMenuPage)
+#define MENU_LABELS(X) \
+	X(LBL_TIME) X(LBL_DATE) X(LBL_UPTIME) X(LBL_ID) X(LBL_ACTIVE) X(LBL_PROGRAM) \
+	X(LBL_TIME_START) X(LBL_TIME_END) X(LBL_WEEKLY) X(LBL_APPLY) X(LBL_CLOCK) \
+	X(LBL_SETTINGS) X(LBL_RECORDINGS)
+
+enum {
+	MENU_RAM = 0 MENU_OBJECTS(FOOTPRINT_RAM) MENU_LABELS(FOOTPRINT_LABEL_RAM),
+	MENU_FLASH = 0 MENU_LABELS(FOOTPRINT_LABEL_FLASH)
+};
+
+// simulator budgets, with its wider pointers
+FOOTPRINT_CHECK(MENU_RAM, 1024, menuRamOverBudget);
+FOOTPRINT_CHECK(MENU_FLASH, 128, menuFlashOverBudget);
+
+const MenuFootprint::Item menuFootprint[] = {
+	MENU_OBJECTS(FOOTPRINT_RAM_ITEM)
+	MENU_LABELS(FOOTPRINT_LABEL_ITEM)
+};
+
+// saved to eeprom
+Property *persistentProperties[] = {
+	&clockProp,
+	&dateProp,
+	&idProp,
+	&activeProp,
+	&programProp,
+	&dateStartProp,
+	&timeStartProp,
+	&timeEndProp,
+	&weeklyProp,
+	NULL
+};
+
+PersistStore *persistStore = NULL;
+
+SerialControl *serialControl = NULL;
+
+static void pollSerialControl()
+{
+	serialControl->poll();
+}
+
+static void saveChanges(Property ** /*changed*/, uint8_t /*count*/, bool /*overflowed*/)
+{
+	persistStore->save();
+}
+
 enum Key {
 	KEY_UP = 'w',
 	KEY_DOWN = 's',
@@ -131,35 +220,407 @@ void NumberedPage::paintLine(uint8_t line, uint8_t row, Screen *screen) const
 	lcd->print(line);
 }
 
-int main(int /*argc*/, char* /*argv*/[])
+const uint8_t cols = 24;
+const uint8_t rows = 2;
+
+#ifdef PROPERTY_MENU_TRACE
+MenuTrace::Record traceStorage[2048];
+MenuTrace trace(traceStorage, 2048, consoleMicros);
+
+static void saveTrace(FILE *report)
+{
+	if (!ChromeTrace::write(trace, "PropertyMenu.trace.json")) {
+		fprintf(stderr, "cannot write PropertyMenu.trace.json\n");
+	}
+	ChromeTrace::printLatency(trace, report);
+	fprintf(report, "paint pages: main 0x%04x, settings 0x%04x, recording 0x%04x\n",
+		MenuTrace::getPageId(&mainMenuPage), MenuTrace::getPageId(&settingsPropPage),
+		MenuTrace::getPageId(&recordingPropPage));
+}
+#endif
+
+// headless run of a key script, see KeyReplay
+static int runReplay(const char *path)
+{
+	FILE *script = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+	if (script == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return 2;
+	}
+	char frame[cols * rows];
+	ShadowLCD shadow(NULL, frame, sizeof(frame));
+	Screen screen(&shadow, cols, rows);
+	char frameCacheStorage[2 * cols * rows];
+	FrameCache frameCache(&shadow, frameCacheStorage, sizeof(frameCacheStorage));
+	MenuNavigator navigator(&screen, &mainMenuPage);
+	navigator.setFrameCache(&frameCache);
+	recordingPropPage.setStaged(true);
+	KeyReplay replay(&shadow, &screen, &navigator);
+#ifdef PROPERTY_MENU_TRACE
+	MenuTrace::setActive(&trace);
+#endif
+	bool ok = replay.run(script, stdout);
+	if (script != stdin) {
+		fclose(script);
+	}
+#ifdef PROPERTY_MENU_TRACE
+	saveTrace(stderr);
+#endif
+	return ok ? 0 : 1;
+}
+
+// benchmark bodies, see runBench()
+static Screen *benchScreen = NULL;
+static LCD *benchLcd = NULL;
+static Property *volatile benchProperty = &timeStartProp;
+
+static void benchScrollablePaint()
+{
+	mainMenuPage.paint(benchScreen);
+}
+
+static void benchPropertyPagePaint()
+{
+	recordingPropPage.paint(benchScreen);
+}
+
+static void benchPaintLine()
+{
+	recordingPropPage.paintLine(4, 0, benchScreen);
+}
+
+static void benchTimePaintEdit()
+{
+	timeStartProp.paintEdit(benchLcd);
+}
+
+static void benchDatePaintEdit()
 {
+	dateStartProp.paintEdit(benchLcd);
+}
+
+static void benchU16PaintEdit()
+{
+	idProp.paintEdit(benchLcd);
+}
+
+static void benchPrintNumber()
+{
+	benchLcd->print(54321U);
+}
+
+// the same paint reached through Property::Kind and through the vtable
+static void benchDispatchStatic()
+{
+	benchProperty->paintValue(benchLcd);
+}
+
+#ifndef PROPERTY_MENU_CLOSED_PROPERTIES
+static void benchDispatchVirtual()
+{
+	benchProperty->paintEdit(benchLcd);
+}
+#endif
+
+static void benchConsolePrint()
+{
+	benchLcd->print("0123456789");
+}
+
+// timing loops on a headless display, the last one through LCDWin to the
+// console; results go to resultsPath and are compared with baselinePath
+static int runBench(const char *resultsPath, const char *baselinePath)
+{
+	char frame[cols * rows];
+	ShadowLCD shadow(NULL, frame, sizeof(frame));
+	Screen screen(&shadow, cols, rows);
+	benchScreen = &screen;
+	benchLcd = &shadow;
+	MicroBench bench(&shadow);
+	bench.run("scrollable_paint", benchScrollablePaint, 20000);
+	bench.run("property_page_paint", benchPropertyPagePaint, 20000);
+	bench.run("paint_line", benchPaintLine, 100000);
+	bench.run("time_paint_edit", benchTimePaintEdit, 100000);
+	bench.run("date_paint_edit", benchDatePaintEdit, 100000);
+	bench.run("u16_paint_edit", benchU16PaintEdit, 100000);
+	bench.run("print_number", benchPrintNumber, 100000);
+	bench.run("dispatch_static", benchDispatchStatic, 100000);
+#ifndef PROPERTY_MENU_CLOSED_PROPERTIES
+	bench.run("dispatch_virtual", benchDispatchVirtual, 100000);
+#endif
 	LCD lcd;
-	Screen screen(&lcd, 24, 2);
-	Page *page = &mainMenuPage;
-	page->paint(&screen);
-	for (;;) {
-		if (_kbhit()) {
-			int k = _getch();
-			if (k == KEY_ESC) {
-				break;
-			}
-			ButtonPress b = translateKey(k);
-			uint8_t line = page->buttonInput(b, &screen);
-			if (page == &mainMenuPage && line != Page::INVALID_LINE && line != 0) {
-				page = mainMenuItems[line-1]->getPage();
-				page->reset();
-				page->paint(&screen);
-			} else if ((page == &settingsPropPage || page == &recordingPropPage) && line == 0) {
-				page = &mainMenuPage;
-				//page->reset(); // no reset for keeping parent position
-				page->paint(&screen);
-			}
-
-			//lcd.setCursor(0, 10);
-			//lcd.print(line);
+	lcd.begin(cols, rows);
+	shadow.setOutput(&lcd);
+	bench.run("console_print", benchConsolePrint, 2000);
+	shadow.setOutput(NULL);
+	lcd.clear();
+	bench.report(stdout);
+	if (baselinePath != NULL && !bench.compare(baselinePath, stdout)) {
+		fprintf(stderr, "cannot read %s\n", baselinePath);
+	}
+	if (!bench.save(resultsPath)) {
+		fprintf(stderr, "cannot write %s\n", resultsPath);
+		return 2;
+	}
+	return 0;
+}
+
+static uint32_t frozenClock()
+{
+	return 0;
+}
+
+// every reachable frame hashed and checked against goldenPath, or written
+// to it when update is set
+static int runGolden(const char *goldenPath, bool update)
+{
+	char frame[cols * rows];
+	ShadowLCD shadow(NULL, frame, sizeof(frame));
+	Screen screen(&shadow, cols, rows);
+	GoldenFrames golden(&shadow, &screen);
+	uptimeClock = frozenClock;
+	recordingPropPage.setStaged(true);
+	uint32_t start = consoleMicros();
+	golden.walk(&mainMenuPage, "Main");
+	uint32_t elapsed = consoleMicros() - start;
+	printf("golden: %u frames in %lu us\n", golden.getCount(),
+		static_cast<unsigned long>(elapsed));
+	if (update) {
+		if (!golden.save(goldenPath)) {
+			fprintf(stderr, "cannot write %s\n", goldenPath);
+			return 2;
+		}
+		return 0;
+	}
+	if (!golden.compare(goldenPath, stdout)) {
+		printf("golden: FAILED\n");
+		return 1;
+	}
+	printf("golden: OK\n");
+	return 0;
+}
+
+// String allocations of every menu state, which must be none, and of
+// labels built the usual Arduino way, replayed on the heap model
+static int runHeap()
+{
+	char frame[cols * rows];
+	ShadowLCD shadow(NULL, frame, sizeof(frame));
+	Screen screen(&shadow, cols, rows);
+	GoldenFrames golden(&shadow, &screen);
+	uptimeClock = frozenClock;
+	{
+		HeapSite site("menu walk");
+		golden.walk(&mainMenuPage, "Main");
+	}
+	{
+		HeapSite site("labels");
+		String labels[4];
+		for (int i = 0; i < 64; ++i) {
+			String label("Rec ");
+			label += i;
+			label += ' ';
+			label += String(i / 4) + ':' + String(i % 4 * 15);
+			labels[i % 4] = label;
 		}
-		Sleep(50);
 	}
+	HeapTracker::report(stdout);
+	const HeapTracker::Site *walk = HeapTracker::findSite("menu walk");
+	if (walk != NULL && walk->allocs + walk->reallocs > 0) {
+		printf("menu walk: %u frames, allocates\n", golden.getCount());
+		return 1;
+	}
+	printf("menu walk: %u frames, allocation-free\n", golden.getCount());
+	return 0;
+}
+
+// random presses checked against the page invariants, see MenuFuzzer
+static int runFuzz(uint32_t events, uint32_t seed)
+{
+	char frame[cols * rows];
+	ShadowLCD shadow(NULL, frame, sizeof(frame));
+	Screen screen(&shadow, cols, rows);
+	char refFrame[cols * rows];
+	ShadowLCD refShadow(NULL, refFrame, sizeof(refFrame));
+	Screen refScreen(&refShadow, cols, rows);
+	char frameCacheStorage[2 * cols * rows];
+	FrameCache frameCache(&shadow, frameCacheStorage, sizeof(frameCacheStorage));
+	MenuNavigator navigator(&screen, &mainMenuPage);
+	navigator.setFrameCache(&frameCache);
+	uptimeClock = frozenClock;
+	recordingPropPage.setStaged(true);
+	MenuFuzzer fuzzer(&shadow, &screen, &navigator, &refShadow, &refScreen);
+	uint32_t start = consoleMillis();
+	bool ok = fuzzer.run(events, seed, stdout);
+	uint32_t elapsed = consoleMillis() - start;
+	printf("fuzz: seed %lu, %lu events in %lu ms, %lu events/s\n",
+		static_cast<unsigned long>(seed),
+		static_cast<unsigned long>(fuzzer.getEvents()),
+		static_cast<unsigned long>(elapsed),
+		static_cast<unsigned long>(elapsed > 0 ? fuzzer.getEvents() * 1000ULL / elapsed : 0));
+	return ok ? 0 : 1;
+}
+
+// a producer thread against the consumer on one ButtonEventQueue, see QueueStress
+static int runStress(uint32_t events)
+{
+	QueueStress stress;
+	uint32_t start = consoleMillis();
+	bool ok = stress.run(events, stdout);
+	uint32_t elapsed = consoleMillis() - start;
+	printf("stress: %lu events in %lu ms, %lu received, %lu refused by a full queue\n",
+		static_cast<unsigned long>(events),
+		static_cast<unsigned long>(elapsed),
+		static_cast<unsigned long>(stress.getReceived()),
+		static_cast<unsigned long>(stress.getRefused()));
+	return ok ? 0 : 1;
+}
+
+// TaskScheduler on a simulated clock, see SchedulerCheck
+static int runScheduler()
+{
+	SchedulerCheck check;
+	bool ok = check.run(stdout);
+	printf("scheduler: %u checks, %s\n", check.getChecks(), ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
+
+// scripted frames through SerialControl, see SerialCheck
+static int runSerial()
+{
+	SerialCheck check;
+	bool ok = check.run(stdout);
+	printf("serial: %u frames, %s\n", check.getFrames(), ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 3 && strcmp(argv[1], "--replay") == 0) {
+		return runReplay(argv[2]);
+	}
+	if ((argc == 3 || argc == 4) && strcmp(argv[1], "--bench") == 0) {
+		return runBench(argv[2], argc == 4 ? argv[3] : NULL);
+	}
+	if (argc == 3 && strcmp(argv[1], "--golden") == 0) {
+		return runGolden(argv[2], false);
+	}
+	if (argc == 3 && strcmp(argv[1], "--golden-update") == 0) {
+		return runGolden(argv[2], true);
+	}
+	if (argc == 2 && strcmp(argv[1], "--heap") == 0) {
+		return runHeap();
+	}
+	if (argc == 2 && strcmp(argv[1], "--footprint") == 0) {
+		FilePrint out(stdout);
+		MenuFootprint::printClasses(&out);
+		MenuFootprint::printItems(&out, menuFootprint,
+			sizeof(menuFootprint) / sizeof(menuFootprint[0]));
+		return 0;
+	}
+	if ((argc == 3 || argc == 4) && strcmp(argv[1], "--fuzz") == 0) {
+		return runFuzz(strtoul(argv[2], NULL, 10), argc == 4 ? strtoul(argv[3], NULL, 10) : 1);
+	}
+	if (argc == 3 && strcmp(argv[1], "--stress") == 0) {
+		return runStress(strtoul(argv[2], NULL, 10));
+	}
+	if (argc == 2 && strcmp(argv[1], "--scheduler") == 0) {
+		return runScheduler();
+	}
+	if (argc == 2 && strcmp(argv[1], "--serial") == 0) {
+		return runSerial();
+	}
+	LCD lcd;
+	char frame[cols * rows];
+	ShadowLCD shadow(&lcd, frame, sizeof(frame));
+	Screen screen(&shadow, cols, rows);
+#ifdef PROPERTY_MENU_STATS
+	shadow.setStatsScreen(&screen);
+#endif
+	char frameCacheStorage[2 * cols * rows];
+	FrameCache frameCache(&shadow, frameCacheStorage, sizeof(frameCacheStorage));
+	ConsoleInput input(translateKey, KEY_ESC);
+	ButtonEventQueue queue;
+	ButtonRepeater repeater;
+	MenuRunner runner(&screen, &input, &queue, &repeater, consoleMillis);
+	ActionQueue actions;
+	PropertyAction::setQueue(&actions);
+	runner.setActionQueue(&actions);
+	TaskScheduler scheduler(consoleMillis);
+	runner.setScheduler(&scheduler, 10);
+	MenuIndex::Entry indexStorage[16];
+	MenuIndex index(indexStorage, 16);
+	index.build(&mainMenuPage);
+	PipePort port("\\\\.\\pipe\\PropertyMenu");
+	char controlLine[128];
+	SerialControl control(&port, &port, &index, controlLine, sizeof(controlLine));
+#ifdef PROPERTY_MENU_STATS
+	control.setScreen(&screen);
+#endif
+	if (port.isOpen()) {
+		fprintf(stderr, "control port: %s\n", port.getName());
+		serialControl = &control;
+		scheduler.add(pollSerialControl, 20);
+	}
+	MenuNavigator navigator(&screen, &mainMenuPage);
+	navigator.setFrameCache(&frameCache);
+	settingsPropPage.setPollPeriod(250);
+	recordingPropPage.setStaged(true);
+	FileEeprom eeprom("PropertyMenu.eep", 512);
+	PersistStore store(&eeprom, persistentProperties, 0, eeprom.getSize());
+	persistStore = &store;
+	store.restore();
+	{
+		// a snapshot, when present, also restores the menu positions
+		MappedFile snapshot("PropertyMenu.snap");
+		if (snapshot.getData() != NULL) {
+			MenuSnapshot::load(&mainMenuPage, snapshot.getData(),
+				static_cast<uint16_t>(snapshot.getSize()));
+		}
+	}
+	Property *changedStorage[10];
+	ChangeTracker tracker(changedStorage, 10, saveChanges);
+	Property::setTracker(&tracker);
+#ifdef PROPERTY_MENU_TRACE
+	MenuTrace::setActive(&trace);
+#endif
+	runner.setPage(navigator.getPage());
+	navigator.getPage()->paint(&screen);
+	while (runner.isRunning()) {
+		if (navigator.handleResult(runner.runOnce())) {
+			runner.setPage(navigator.getPage());
+		}
+	}
+	uint8_t snapshot[64];
+	uint16_t snapshotSize = MenuSnapshot::save(&mainMenuPage, snapshot, sizeof(snapshot));
+	FILE *f = fopen("PropertyMenu.snap", "wb");
+	if (f != NULL) {
+		fwrite(snapshot, 1, snapshotSize, f);
+		fclose(f);
+	}
+	printf("snapshot: %u bytes\n", snapshotSize);
+	if (store.getSaveCount() > 0) {
+		printf("eeprom: %u saves, %lu bytes written, %lu bytes per save, %lu ms\n",
+			store.getSaveCount(),
+			static_cast<unsigned long>(store.getBytesWritten()),
+			static_cast<unsigned long>(store.getBytesWritten() / store.getSaveCount()),
+			static_cast<unsigned long>(eeprom.getWriteTimeUs() / 1000));
+	}
+#ifdef PROPERTY_MENU_STATS
+	const Screen::Stats &stats = screen.getStats();
+	printf("screen: %lu full and %lu partial paints, %lu clears, %lu commands, %lu bytes\n",
+		static_cast<unsigned long>(stats.fullPaints),
+		static_cast<unsigned long>(stats.partialPaints),
+		static_cast<unsigned long>(stats.clears),
+		static_cast<unsigned long>(stats.commands),
+		static_cast<unsigned long>(stats.dataBytes));
+	printf("screen: %lu events, %u bytes per event, %u max\n",
+		static_cast<unsigned long>(stats.events),
+		screen.getAvgEventBytes(), stats.maxEventBytes);
+#endif
+#ifdef PROPERTY_MENU_TRACE
+	saveTrace(stdout);
+#endif
 	return 0;
 }
 
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include "ChromeTrace.h"
+
+static const char *const scopeNames[MenuTrace::SCOPE_COUNT] = {
+	"input",
+	"buttonInput",
+	"paint",
+	"paintLine",
+	"flush"
+};
+
+static int compareDurations(const void *a, const void *b)
+{
+	uint32_t x = *static_cast<const uint32_t *>(a);
+	uint32_t y = *static_cast<const uint32_t *>(b);
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+const char *ChromeTrace::getScopeName(uint8_t scope)
+{
+	assert(scope < MenuTrace::SCOPE_COUNT);
+	return scopeNames[scope];
+}
+
+bool ChromeTrace::write(const MenuTrace &trace, FILE *f)
+{
+	assert(f != NULL);
+	uint16_t open[MenuTrace::SCOPE_COUNT] = { 0 };
+	fprintf(f, "{\"traceEvents\":[");
+	const char *separator = "\n";
+	for (uint16_t i = 0; i < trace.getCount(); ++i) {
+		const MenuTrace::Record &r = trace.getRecord(i);
+		if (r.phase == MenuTrace::PHASE_END) {
+			if (open[r.scope] == 0) {
+				continue;
+			}
+			open[r.scope]--;
+		} else {
+			open[r.scope]++;
+		}
+		fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":1",
+			separator, getScopeName(r.scope), r.phase == MenuTrace::PHASE_BEGIN ? 'B' : 'E',
+			static_cast<unsigned long>(r.timeUs));
+		if (r.phase == MenuTrace::PHASE_BEGIN && r.scope == MenuTrace::SCOPE_PAINT) {
+			fprintf(f, ",\"args\":{\"page\":\"0x%04x\"}", r.arg);
+		} else if (r.phase == MenuTrace::PHASE_BEGIN) {
+			fprintf(f, ",\"args\":{\"arg\":%u}", r.arg);
+		}
+		fprintf(f, "}");
+		separator = ",\n";
+	}
+	fprintf(f, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%lu}}\n",
+		static_cast<unsigned long>(trace.getDropped()));
+	return ferror(f) == 0;
+}
+
+bool ChromeTrace::write(const MenuTrace &trace, const char *path)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		return false;
+	}
+	bool ok = write(trace, f);
+	return fclose(f) == 0 && ok;
+}
+
+void ChromeTrace::printLatency(const MenuTrace &trace, FILE *f)
+{
+	uint32_t durations[MAX_INPUTS];
+	uint16_t count = 0;
+	bool open = false;
+	uint32_t start = 0;
+	for (uint16_t i = 0; i < trace.getCount() && count < MAX_INPUTS; ++i) {
+		const MenuTrace::Record &r = trace.getRecord(i);
+		if (r.scope != MenuTrace::SCOPE_INPUT) {
+			continue;
+		}
+		if (r.phase == MenuTrace::PHASE_BEGIN) {
+			open = true;
+			start = r.timeUs;
+		} else if (open) {
+			open = false;
+			durations[count++] = r.timeUs - start;
+		}
+	}
+	if (count == 0) {
+		fprintf(f, "input latency: no inputs traced\n");
+		return;
+	}
+	qsort(durations, count, sizeof(durations[0]), compareDurations);
+	fprintf(f, "input latency: %u inputs, p50 %lu us, p99 %lu us, max %lu us\n", count,
+		static_cast<unsigned long>(durations[(count - 1) / 2]),
+		static_cast<unsigned long>(durations[(count - 1) * 99 / 100]),
+		static_cast<unsigned long>(durations[count - 1]));
+}
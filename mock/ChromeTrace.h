@@ -0,0 +1,24 @@
+#ifndef _CHROME_TRACE_H_
+#define _CHROME_TRACE_H_
+
+#include <stdio.h>
+#include "MenuTrace.h"
+
+// Writes a MenuTrace in the trace_event JSON format read by chrome://tracing
+// and Perfetto, and sums up the input latency.
+class ChromeTrace
+{
+public:
+	enum {
+		MAX_INPUTS = 512 // input scopes the percentiles are computed on
+	};
+	static const char *getScopeName(uint8_t scope);
+	// end records whose begin was overwritten are skipped; paint events
+	// carry the page id of MenuTrace::getPageId() in hex
+	static bool write(const MenuTrace &trace, FILE *f);
+	static bool write(const MenuTrace &trace, const char *path);
+	// count, p50, p99 and max duration of the input scopes
+	static void printLatency(const MenuTrace &trace, FILE *f);
+};
+
+#endif
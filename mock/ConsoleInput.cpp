@@ -0,0 +1,79 @@
+#include "ConsoleInput.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+ConsoleInput::ConsoleInput(KeyTranslator translator, int quitKey)
+: _translator(translator),
+	_quitKey(quitKey),
+	_heldKey(0),
+	_held(BUTTON_PRESS_NONE)
+{
+}
+
+ConsoleInput::~ConsoleInput()
+{
+}
+
+void ConsoleInput::wait(const ButtonEventQueue * /*queue*/, uint32_t timeoutMs)
+{
+	// also woken by key up, focus and mouse records: read() consumes them
+	WaitForSingleObject(GetStdHandle(STD_INPUT_HANDLE),
+		timeoutMs == WAIT_FOREVER ? INFINITE : timeoutMs);
+}
+
+bool ConsoleInput::read(ButtonEventQueue *queue, uint32_t now)
+{
+	HANDLE in = GetStdHandle(STD_INPUT_HANDLE);
+	DWORD available = 0;
+	while (GetNumberOfConsoleInputEvents(in, &available) && available > 0) {
+		INPUT_RECORD record;
+		DWORD count = 0;
+		if (!ReadConsoleInputA(in, &record, 1, &count) || count == 0) {
+			break;
+		}
+		// only key records count, all other records are dropped
+		if (record.EventType != KEY_EVENT) {
+			continue;
+		}
+		const KEY_EVENT_RECORD &key = record.Event.KeyEvent;
+		int k = static_cast<unsigned char>(key.uChar.AsciiChar);
+		if (!key.bKeyDown) {
+			if (key.wVirtualKeyCode == _heldKey && _held != BUTTON_PRESS_NONE) {
+				queue->push(static_cast<ButtonPress>(_held), true, now);
+				_held = BUTTON_PRESS_NONE;
+			}
+			continue;
+		}
+		if (k == _quitKey) {
+			return false;
+		}
+		ButtonPress b = _translator(k);
+		// the console repeats the key down of a held key: the ButtonRepeater
+		// of the runner times the repeats instead
+		if (b == BUTTON_PRESS_NONE || b == _held) {
+			continue;
+		}
+		if (_held != BUTTON_PRESS_NONE) {
+			queue->push(static_cast<ButtonPress>(_held), true, now);
+		}
+		queue->push(b, false, now);
+		_held = b;
+		_heldKey = key.wVirtualKeyCode;
+	}
+	return true;
+}
+
+uint32_t consoleMillis()
+{
+	return GetTickCount();
+}
+
+uint32_t consoleMicros()
+{
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return static_cast<uint32_t>(counter.QuadPart * 1000000 / frequency.QuadPart);
+}
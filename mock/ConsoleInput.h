@@ -0,0 +1,29 @@
+#ifndef _CONSOLE_INPUT_H_
+#define _CONSOLE_INPUT_H_
+
+#include "MenuRunner.h"
+
+typedef ButtonPress (*KeyTranslator)(int key);
+
+// Host keyboard for MenuRunner: blocks on the console input handle instead
+// of polling _kbhit(). Reports key down and key up like button edges, so a
+// ButtonRepeater generates the auto-repeat and long press events.
+class ConsoleInput : public InputSource
+{
+public:
+	ConsoleInput(KeyTranslator translator, int quitKey);
+	~ConsoleInput();
+	void wait(const ButtonEventQueue *queue, uint32_t timeoutMs);
+	bool read(ButtonEventQueue *queue, uint32_t now);
+
+private:
+	KeyTranslator _translator;
+	int _quitKey;
+	uint16_t _heldKey; // virtual key code of _held
+	int8_t _held;
+};
+
+uint32_t consoleMillis();
+uint32_t consoleMicros();
+
+#endif
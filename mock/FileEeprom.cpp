@@ -0,0 +1,61 @@
+#include <string.h>
+#include "FileEeprom.h"
+
+FileEeprom::FileEeprom(const char *path, uint16_t size)
+: _size(size),
+	_writes(0)
+{
+	assert(size <= MAX_SIZE);
+	// an erased EEPROM reads 0xff
+	memset(_data, 0xff, sizeof(_data));
+	_file = fopen(path, "r+b");
+	if (_file != NULL) {
+		// a short or failed read erases the image, and the file with it
+		if (fread(_data, 1, _size, _file) != _size) {
+			memset(_data, 0xff, sizeof(_data));
+			rewind(_file);
+			writeAll();
+		}
+	} else {
+		_file = fopen(path, "w+b");
+		writeAll();
+	}
+}
+
+void FileEeprom::writeAll()
+{
+	if (_file != NULL) {
+		fwrite(_data, 1, _size, _file);
+		fflush(_file);
+	}
+}
+
+FileEeprom::~FileEeprom()
+{
+	if (_file != NULL) {
+		fclose(_file);
+	}
+}
+
+uint16_t FileEeprom::getSize() const
+{
+	return _size;
+}
+
+uint8_t FileEeprom::read(uint16_t addr) const
+{
+	assert(addr < _size);
+	return _data[addr];
+}
+
+void FileEeprom::write(uint16_t addr, uint8_t value)
+{
+	assert(addr < _size);
+	_data[addr] = value;
+	_writes++;
+	if (_file != NULL) {
+		fseek(_file, addr, SEEK_SET);
+		fputc(value, _file);
+		fflush(_file);
+	}
+}
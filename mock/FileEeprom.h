@@ -0,0 +1,34 @@
+#ifndef _FILE_EEPROM_H_
+#define _FILE_EEPROM_H_
+
+#include <stdio.h>
+#include "Persistence.h"
+
+// EEPROM emulated by a file, so the simulator keeps its settings between
+// runs. Each write goes to the file at once and is counted, together with
+// the time the AVR would have spent on it.
+class FileEeprom : public EepromDevice
+{
+public:
+	enum {
+		MAX_SIZE = 4096,
+		WRITE_US = 3300
+	};
+	FileEeprom(const char *path, uint16_t size);
+	~FileEeprom();
+	uint16_t getSize() const;
+	uint8_t read(uint16_t addr) const;
+	void write(uint16_t addr, uint8_t value);
+	uint32_t getWrites() const { return _writes; }
+	uint32_t getWriteTimeUs() const { return _writes * WRITE_US; }
+
+private:
+	void writeAll();
+
+	FILE *_file;
+	uint16_t _size;
+	uint32_t _writes;
+	uint8_t _data[MAX_SIZE];
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef _FILE_PRINT_H_
+#define _FILE_PRINT_H_
+
+#include <stdio.h>
+#include "Print.h"
+
+// Print writing to a stdio stream, for library reports on the console
+class FilePrint : public Print
+{
+public:
+	explicit FilePrint(FILE *f) : _f(f) {}
+	size_t write(uint8_t c) { return fputc(c, _f) == EOF ? 0 : 1; }
+
+private:
+	FILE *_f;
+};
+
+#endif
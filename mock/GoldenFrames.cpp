@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include "GoldenFrames.h"
+
+static const char *nameOf(const __FlashStringHelper *name)
+{
+	return reinterpret_cast<const char *>(name);
+}
+
+GoldenFrames::GoldenFrames(ShadowLCD *lcd, Screen *screen)
+: _lcd(lcd),
+	_screen(screen),
+	_count(0)
+{
+	assert(lcd != NULL);
+	assert(screen != NULL);
+}
+
+void GoldenFrames::walk(Page *root, const char *rootName)
+{
+	assert(root != NULL);
+	assert(rootName != NULL);
+	_count = 0;
+	walkPage(root, rootName, 0);
+}
+
+void GoldenFrames::walkPage(Page *page, const char *path, uint8_t depth)
+{
+	assert(depth < MAX_DEPTH);
+	char key[MAX_KEY];
+	// breadth first over the states reached with up and down
+	uint16_t states[MAX_STATES];
+	uint16_t count = 0;
+	page->reset();
+	states[count++] = page->getState();
+	for (uint16_t i = 0; i < count; ++i) {
+		page->setState(states[i]);
+		page->paint(_screen);
+		snprintf(key, sizeof(key), "%s@%04x", path, states[i]);
+		add(key);
+		static const ButtonPress moves[] = { BUTTON_PRESS_DOWN, BUTTON_PRESS_UP };
+		for (uint8_t m = 0; m < sizeof(moves) / sizeof(moves[0]); ++m) {
+			page->setState(states[i]);
+			page->buttonInput(moves[m], _screen);
+			uint16_t next = page->getState();
+			bool seen = false;
+			for (uint16_t j = 0; j < count && !seen; ++j) {
+				seen = states[j] == next;
+			}
+			if (!seen) {
+				assert(count < MAX_STATES);
+				states[count++] = next;
+			}
+		}
+	}
+	for (uint8_t line = 0; line < page->getLineCount(); ++line) {
+		walkFocus(page, line, path);
+	}
+	for (uint8_t line = 0; line < page->getLineCount(); ++line) {
+		Page *child = page->getChildPage(line + 1);
+		const __FlashStringHelper *name = page->getLineName(line);
+		if (child != NULL && name != NULL) {
+			snprintf(key, sizeof(key), "%s/%s", path, nameOf(name));
+			walkPage(child, key, depth + 1);
+		}
+	}
+	page->reset();
+}
+
+void GoldenFrames::walkFocus(Page *page, uint8_t line, const char *path)
+{
+	Property *p = page->getProperty(line);
+	if (p == NULL || p->isReadOnly() || p->getKind() == Property::KIND_ACTION) {
+		return;
+	}
+	char key[MAX_KEY];
+	page->reset();
+	page->showLine(line + 1, _screen->getRows());
+	page->paint(_screen);
+	uint16_t state = page->getState();
+	// enter goes through the parts and leaves editing after the last one
+	for (uint8_t presses = 0; presses < 16; ++presses) {
+		page->buttonInput(BUTTON_PRESS_ENTER, _screen);
+		if (p->getFocusPart() == 0) {
+			return;
+		}
+		snprintf(key, sizeof(key), "%s@%04x+%u", path, state, p->getFocusPart());
+		add(key);
+	}
+	assert(false);
+}
+
+void GoldenFrames::add(const char *key)
+{
+	assert(_count < MAX_FRAMES);
+	Frame &f = _frames[_count++];
+	strncpy(f.key, key, MAX_KEY - 1);
+	f.key[MAX_KEY - 1] = 0;
+	f.hash = _lcd->getFrameHash();
+}
+
+int GoldenFrames::find(const char *key, uint16_t hint) const
+{
+	// files are written in walk order, so the next frame is usually it
+	for (uint16_t n = 0; n < _count; ++n) {
+		uint16_t i = (hint + n) % _count;
+		if (strcmp(_frames[i].key, key) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool GoldenFrames::save(const char *path) const
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		return false;
+	}
+	fprintf(f, "# key\tfnv1a\n");
+	for (uint16_t i = 0; i < _count; ++i) {
+		fprintf(f, "%s\t%08lx\n", _frames[i].key, static_cast<unsigned long>(_frames[i].hash));
+	}
+	return fclose(f) == 0;
+}
+
+bool GoldenFrames::compare(const char *path, FILE *report) const
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		fprintf(report, "cannot read %s\n", path);
+		return false;
+	}
+	bool matched[MAX_FRAMES] = { false };
+	uint16_t hint = 0;
+	uint16_t failures = 0;
+	char line[MAX_KEY + 32];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		// keys may hold blanks, the hash follows the tab
+		char *tab = strchr(line, '\t');
+		if (line[0] == '#' || tab == NULL) {
+			continue;
+		}
+		*tab = 0;
+		const char *key = line;
+		unsigned long hash = strtoul(tab + 1, NULL, 16);
+		int i = find(key, hint);
+		if (i < 0) {
+			fprintf(report, "missing\t%s\n", key);
+			failures++;
+			continue;
+		}
+		matched[i] = true;
+		hint = static_cast<uint16_t>(i + 1);
+		if (_frames[i].hash != hash) {
+			fprintf(report, "differs\t%s\t%08lx\t%08lx\n", key, hash,
+				static_cast<unsigned long>(_frames[i].hash));
+			failures++;
+		}
+	}
+	fclose(f);
+	for (uint16_t i = 0; i < _count; ++i) {
+		if (!matched[i]) {
+			fprintf(report, "new\t%s\n", _frames[i].key);
+			failures++;
+		}
+	}
+	return failures == 0;
+}
@@ -0,0 +1,46 @@
+#ifndef _GOLDEN_FRAMES_H_
+#define _GOLDEN_FRAMES_H_
+
+#include <stdio.h>
+#include "ShadowLCD.h"
+
+// Walks every menu state reachable with the buttons, pages by scroll
+// positions by focus parts, paints it on a headless ShadowLCD and keeps
+// the frame hash. Scroll states are painted in full, focus parts by the
+// partial repaint of Page::buttonInput(). The hashes are saved to or
+// checked against a golden file of "key<TAB>hash" lines, where the key is
+// the page path, '@' and Page::getState() in hex, '+' and the focus part.
+class GoldenFrames
+{
+public:
+	enum {
+		MAX_FRAMES = 4096,
+		MAX_KEY = 64,
+		MAX_STATES = 256, // per page
+		MAX_DEPTH = 8
+	};
+	GoldenFrames(ShadowLCD *lcd, Screen *screen);
+	void walk(Page *root, const char *rootName);
+	uint16_t getCount() const { return _count; }
+	bool save(const char *path) const;
+	// reports frames that differ, are missing or new; false if any, or if
+	// the file cannot be read
+	bool compare(const char *path, FILE *report) const;
+
+private:
+	struct Frame {
+		char key[MAX_KEY];
+		uint32_t hash;
+	};
+	void walkPage(Page *page, const char *path, uint8_t depth);
+	void walkFocus(Page *page, uint8_t line, const char *path);
+	void add(const char *key);
+	int find(const char *key, uint16_t hint) const;
+
+	ShadowLCD *_lcd;
+	Screen *_screen;
+	uint16_t _count;
+	Frame _frames[MAX_FRAMES];
+};
+
+#endif
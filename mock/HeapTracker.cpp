@@ -0,0 +1,296 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HeapTracker.h"
+
+static const char OTHER_SITE[] = "other";
+
+HeapTracker::Site HeapTracker::_sites[MAX_SITES];
+uint8_t HeapTracker::_siteCount = 0;
+const char *HeapTracker::_current = OTHER_SITE;
+uint32_t HeapTracker::_live = 0;
+HeapTracker::Block HeapTracker::_blocks[MAX_LIVE];
+uint16_t HeapTracker::_blockCount = 0;
+HeapTracker::Chunk HeapTracker::_chunks[MAX_CHUNKS] = { { 0, HEAP_SIZE, 0 } };
+uint8_t HeapTracker::_chunkCount = 1;
+uint16_t HeapTracker::_simUsed = 0;
+uint16_t HeapTracker::_simPeak = 0;
+uint16_t HeapTracker::_simMinLargestFree = HEAP_SIZE;
+uint32_t HeapTracker::_simFailures = 0;
+
+void *HeapTracker::reallocate(void *ptr, size_t size)
+{
+	uintptr_t old = reinterpret_cast<uintptr_t>(ptr);
+	void *p = realloc(ptr, size);
+	if (p == NULL) {
+		return NULL;
+	}
+	uintptr_t key = reinterpret_cast<uintptr_t>(p);
+	Site *site = currentSite();
+	if (old == 0) {
+		site->allocs++;
+		simAlloc(key, size);
+	} else {
+		site->reallocs++;
+		simRealloc(old, key, size);
+	}
+	site->bytes += static_cast<uint32_t>(size);
+	setLive(old, key, size);
+	if (_live > site->peak) {
+		site->peak = _live;
+	}
+	return p;
+}
+
+void HeapTracker::release(void *ptr)
+{
+	if (ptr == NULL) {
+		return;
+	}
+	uintptr_t key = reinterpret_cast<uintptr_t>(ptr);
+	free(ptr);
+	currentSite()->frees++;
+	simFree(key);
+	setLive(key, 0, 0);
+}
+
+const char *HeapTracker::enter(const char *site)
+{
+	assert(site != NULL);
+	const char *previous = _current;
+	_current = site;
+	return previous;
+}
+
+void HeapTracker::leave(const char *previous)
+{
+	_current = previous;
+}
+
+const HeapTracker::Site *HeapTracker::findSite(const char *name)
+{
+	for (uint8_t i = 0; i < _siteCount; ++i) {
+		if (strcmp(_sites[i].name, name) == 0) {
+			return &_sites[i];
+		}
+	}
+	return NULL;
+}
+
+HeapTracker::Site *HeapTracker::currentSite()
+{
+	Site *site = const_cast<Site *>(findSite(_current));
+	if (site == NULL) {
+		// the last slot takes what does not fit
+		site = &_sites[_siteCount < MAX_SITES ? _siteCount++ : MAX_SITES - 1];
+		memset(site, 0, sizeof(*site));
+		site->name = _current;
+	}
+	return site;
+}
+
+// buffers are not freed here, only forgotten: live ones stay in the model
+void HeapTracker::reset()
+{
+	for (uint8_t i = 0; i < _siteCount; ++i) {
+		const char *name = _sites[i].name;
+		memset(&_sites[i], 0, sizeof(_sites[i]));
+		_sites[i].name = name;
+	}
+	_simPeak = _simUsed;
+	_simMinLargestFree = HEAP_SIZE;
+	_simFailures = 0;
+	simUpdate();
+}
+
+// records the size of ptr, which replaces oldPtr
+void HeapTracker::setLive(uintptr_t oldPtr, uintptr_t ptr, size_t size)
+{
+	size_t oldSize = 0;
+	uint16_t i = 0;
+	if (oldPtr != 0) {
+		while (i < _blockCount && _blocks[i].ptr != oldPtr) {
+			++i;
+		}
+		if (i < _blockCount) {
+			oldSize = _blocks[i].size;
+			_blocks[i] = _blocks[--_blockCount];
+		}
+	}
+	_live -= static_cast<uint32_t>(oldSize);
+	if (ptr != 0 && _blockCount < MAX_LIVE) {
+		_blocks[_blockCount].ptr = ptr;
+		_blocks[_blockCount].size = size;
+		_blockCount++;
+		_live += static_cast<uint32_t>(size);
+	}
+}
+
+int HeapTracker::simFind(uintptr_t owner)
+{
+	for (uint8_t i = 0; i < _chunkCount; ++i) {
+		if (_chunks[i].owner == owner) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// leaves size bytes in chunk idx and a free chunk after it, if worth one
+void HeapTracker::simSplit(int idx, uint16_t size)
+{
+	Chunk &c = _chunks[idx];
+	if (c.size - size <= CHUNK_HEADER || _chunkCount == MAX_CHUNKS) {
+		return;
+	}
+	memmove(&_chunks[idx + 2], &_chunks[idx + 1], (_chunkCount - idx - 1) * sizeof(Chunk));
+	_chunkCount++;
+	Chunk &rest = _chunks[idx + 1];
+	rest.offset = c.offset + size;
+	rest.size = c.size - size;
+	rest.owner = 0;
+	c.size = size;
+	simMerge(idx + 1);
+}
+
+// joins free chunk idx with the free neighbours
+void HeapTracker::simMerge(int idx)
+{
+	if (idx + 1 < _chunkCount && _chunks[idx + 1].owner == 0) {
+		_chunks[idx].size += _chunks[idx + 1].size;
+		memmove(&_chunks[idx + 1], &_chunks[idx + 2], (_chunkCount - idx - 2) * sizeof(Chunk));
+		_chunkCount--;
+	}
+	if (idx > 0 && _chunks[idx - 1].owner == 0) {
+		_chunks[idx - 1].size += _chunks[idx].size;
+		memmove(&_chunks[idx], &_chunks[idx + 1], (_chunkCount - idx - 1) * sizeof(Chunk));
+		_chunkCount--;
+	}
+}
+
+// best fit as avr-libc: a free chunk of the exact size, else the smallest
+// one that fits; the free top of the heap, above __brkval, only when no
+// freed chunk fits
+bool HeapTracker::simAlloc(uintptr_t owner, size_t size)
+{
+	uint16_t need = static_cast<uint16_t>(size + CHUNK_HEADER);
+	int best = -1;
+	uint8_t top = _chunkCount - 1;
+	for (uint8_t i = 0; i < top; ++i) {
+		const Chunk &c = _chunks[i];
+		if (c.owner != 0 || c.size < need) {
+			continue;
+		}
+		if (best < 0 || c.size < _chunks[best].size) {
+			best = i;
+		}
+		if (c.size == need) {
+			break;
+		}
+	}
+	if (best < 0 && _chunks[top].owner == 0 && _chunks[top].size >= need) {
+		best = top;
+	}
+	if (best < 0) {
+		_simFailures++;
+		return false;
+	}
+	_chunks[best].owner = owner;
+	simSplit(best, need);
+	simUpdate();
+	return true;
+}
+
+void HeapTracker::simFree(uintptr_t owner)
+{
+	int idx = simFind(owner);
+	if (idx >= 0) {
+		_chunks[idx].owner = 0;
+		simMerge(idx);
+		simUpdate();
+	}
+}
+
+// in place when shrinking or when the next chunk is free and big enough,
+// else a new chunk and the old one freed, as avr-libc does
+void HeapTracker::simRealloc(uintptr_t oldOwner, uintptr_t owner, size_t size)
+{
+	int idx = simFind(oldOwner);
+	if (idx < 0) {
+		simAlloc(owner, size);
+		return;
+	}
+	uint16_t need = static_cast<uint16_t>(size + CHUNK_HEADER);
+	Chunk &c = _chunks[idx];
+	if (need <= c.size) {
+		c.owner = owner;
+		simSplit(idx, need);
+	} else if (idx + 1 < _chunkCount && _chunks[idx + 1].owner == 0
+		&& c.size + _chunks[idx + 1].size >= need) {
+		c.owner = owner;
+		c.size += _chunks[idx + 1].size;
+		memmove(&_chunks[idx + 1], &_chunks[idx + 2], (_chunkCount - idx - 2) * sizeof(Chunk));
+		_chunkCount--;
+		simSplit(idx, need);
+	} else {
+		// held by a key no buffer has while the new chunk is taken; when
+		// none fits avr-libc returns NULL and the old buffer stays, here
+		// under the key the program now uses
+		c.owner = reinterpret_cast<uintptr_t>(&_chunks);
+		if (simAlloc(owner, size)) {
+			simFree(reinterpret_cast<uintptr_t>(&_chunks));
+		} else {
+			_chunks[simFind(reinterpret_cast<uintptr_t>(&_chunks))].owner = owner;
+		}
+	}
+	simUpdate();
+}
+
+void HeapTracker::simUpdate()
+{
+	uint16_t used = 0;
+	uint16_t largestFree = 0;
+	for (uint8_t i = 0; i < _chunkCount; ++i) {
+		if (_chunks[i].owner != 0) {
+			used += _chunks[i].size;
+		} else if (_chunks[i].size > largestFree) {
+			largestFree = _chunks[i].size;
+		}
+	}
+	_simUsed = used;
+	if (used > _simPeak) {
+		_simPeak = used;
+	}
+	if (largestFree < _simMinLargestFree) {
+		_simMinLargestFree = largestFree;
+	}
+}
+
+void HeapTracker::report(FILE *f)
+{
+	fprintf(f, "site                  allocs  reallocs     frees     bytes   peak\n");
+	for (uint8_t i = 0; i < _siteCount; ++i) {
+		const Site &s = _sites[i];
+		fprintf(f, "%-20s %7lu %9lu %9lu %9lu %6lu\n", s.name,
+			static_cast<unsigned long>(s.allocs), static_cast<unsigned long>(s.reallocs),
+			static_cast<unsigned long>(s.frees), static_cast<unsigned long>(s.bytes),
+			static_cast<unsigned long>(s.peak));
+	}
+	uint16_t freeBytes = 0;
+	uint16_t largestFree = 0;
+	uint8_t holes = 0;
+	for (uint8_t i = 0; i < _chunkCount; ++i) {
+		if (_chunks[i].owner == 0) {
+			freeBytes += _chunks[i].size;
+			holes++;
+			if (_chunks[i].size > largestFree) {
+				largestFree = _chunks[i].size;
+			}
+		}
+	}
+	fprintf(f, "heap model: %u bytes, %u used, peak %u, %u free in %u holes, largest %u"
+		" (lowest %u), fragmentation %u%%, %lu failed\n",
+		HEAP_SIZE, _simUsed, _simPeak, freeBytes, holes, largestFree, _simMinLargestFree,
+		freeBytes > 0 ? 100 - largestFree * 100 / freeBytes : 0,
+		static_cast<unsigned long>(_simFailures));
+}
@@ -0,0 +1,85 @@
+#ifndef _HEAP_TRACKER_H_
+#define _HEAP_TRACKER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Counts the String allocations per call site and replays them on a model
+// of a small best fit heap, like avr-libc malloc() on a few hundred free
+// bytes, to show the fragmentation that realloc() growth leaves behind.
+// Sites are named by HeapSite scopes around the code of interest; what
+// runs outside any is counted under "other".
+class HeapTracker
+{
+public:
+	enum {
+		MAX_SITES = 16,
+		HEAP_SIZE = 512, // simulated bytes
+		CHUNK_HEADER = 2, // size word of each avr-libc chunk
+		MAX_CHUNKS = 64,
+		MAX_LIVE = 256 // real buffers tracked for the live byte count
+	};
+	struct Site {
+		const char *name;
+		uint32_t allocs; // from no buffer
+		uint32_t reallocs; // of an existing buffer
+		uint32_t frees;
+		uint32_t bytes; // requested by allocs and reallocs
+		uint32_t peak; // live bytes at most while the site ran
+	};
+	// realloc() and free() for String, counted
+	static void *reallocate(void *ptr, size_t size);
+	static void release(void *ptr);
+	static const char *enter(const char *site); // returns the previous site
+	static void leave(const char *previous);
+	static const Site *findSite(const char *name);
+	static void reset();
+	static void report(FILE *f);
+
+private:
+	// addresses are kept as integers, they are keys only
+	struct Block {
+		uintptr_t ptr;
+		size_t size;
+	};
+	struct Chunk {
+		uint16_t offset;
+		uint16_t size; // header included
+		uintptr_t owner; // 0 if free
+	};
+	static Site *currentSite();
+	static void setLive(uintptr_t oldPtr, uintptr_t ptr, size_t size);
+	static bool simAlloc(uintptr_t owner, size_t size); // false if the model has no room
+	static void simFree(uintptr_t owner);
+	static void simRealloc(uintptr_t oldOwner, uintptr_t owner, size_t size);
+	static int simFind(uintptr_t owner);
+	static void simSplit(int idx, uint16_t size);
+	static void simMerge(int idx);
+	static void simUpdate();
+
+	static Site _sites[MAX_SITES];
+	static uint8_t _siteCount;
+	static const char *_current;
+	static uint32_t _live;
+	static Block _blocks[MAX_LIVE];
+	static uint16_t _blockCount;
+	static Chunk _chunks[MAX_CHUNKS];
+	static uint8_t _chunkCount;
+	static uint16_t _simUsed;
+	static uint16_t _simPeak;
+	static uint16_t _simMinLargestFree;
+	static uint32_t _simFailures;
+};
+
+// names the allocations made in its scope
+class HeapSite
+{
+public:
+	explicit HeapSite(const char *name) : _previous(HeapTracker::enter(name)) {}
+	~HeapSite() { HeapTracker::leave(_previous); }
+
+private:
+	const char *_previous;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "KeyReplay.h"
+
+static ButtonPress keyButton(int key)
+{
+	switch (key) {
+	case 'd':
+		return BUTTON_PRESS_DOWN;
+	case 'u':
+		return BUTTON_PRESS_UP;
+	case 'e':
+		return BUTTON_PRESS_ENTER;
+	case 'D':
+		return BUTTON_PRESS_HOLD_DOWN;
+	case 'U':
+		return BUTTON_PRESS_HOLD_UP;
+	case 'E':
+		return BUTTON_PRESS_HOLD_ENTER;
+	default:
+		return BUTTON_PRESS_NONE;
+	}
+}
+
+static void printCounters(FILE *report, const ShadowLCD::Counters &c)
+{
+	fprintf(report, "\t%lu\t%lu\t%lu\t%lu\t%lu\n",
+		static_cast<unsigned long>(c.clears),
+		static_cast<unsigned long>(c.cursorMoves),
+		static_cast<unsigned long>(c.commands),
+		static_cast<unsigned long>(c.dataBytes),
+		static_cast<unsigned long>(ShadowLCD::getBusTimeUs(c)));
+}
+
+KeyReplay::KeyReplay(ShadowLCD *lcd, Screen *screen, MenuNavigator *navigator)
+: _lcd(lcd),
+	_screen(screen),
+	_navigator(navigator),
+	_dispatcher(&_queue, NULL),
+	_steps(0)
+{
+	assert(lcd != NULL);
+	assert(screen != NULL);
+	assert(navigator != NULL);
+	memset(&_totals, 0, sizeof(_totals));
+}
+
+bool KeyReplay::run(FILE *script, FILE *report)
+{
+	assert(script != NULL);
+	assert(report != NULL);
+	fprintf(report, "step\tkey\tclears\tcursor\tcommands\tdata\tbus_us\n");
+	step('-', report);
+	bool ok = true;
+	int c;
+	while (ok && (c = fgetc(script)) != EOF) {
+		if (c == '#') {
+			while (c != EOF && c != '\n') {
+				c = fgetc(script);
+			}
+		} else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+			continue;
+		} else if (keyButton(c) == BUTTON_PRESS_NONE) {
+			fprintf(report, "bad key '%c'\n", c);
+			ok = false;
+		} else {
+			step(static_cast<char>(c), report);
+		}
+	}
+	fprintf(report, "total\t%u", _steps);
+	printCounters(report, _totals);
+	for (uint8_t r = 0; r < _lcd->getRows(); ++r) {
+		fprintf(report, "frame\t|%.*s|\n", _lcd->getCols(), _lcd->getFrame() + r * _lcd->getCols());
+	}
+	return ok;
+}
+
+// one key, or the initial paint for '-'
+void KeyReplay::step(char key, FILE *report)
+{
+	_lcd->resetCounters();
+	if (key == '-') {
+		_navigator->getPage()->paint(_screen);
+	} else {
+		_queue.push(keyButton(key), false, 0);
+		_queue.push(keyButton(key), true, 0);
+		Page *page = _navigator->getPage();
+		_navigator->handleResult(_dispatcher.dispatch(page, _screen, 0));
+		_navigator->getPage()->refresh(_screen);
+		_dispatcher.endInput();
+	}
+	const ShadowLCD::Counters &c = _lcd->getCounters();
+	_totals.commands += c.commands;
+	_totals.clears += c.clears;
+	_totals.homes += c.homes;
+	_totals.cursorMoves += c.cursorMoves;
+	_totals.dataBytes += c.dataBytes;
+	if (key != '-') {
+		_steps++;
+	}
+	fprintf(report, "%u\t%c", _steps, key);
+	printCounters(report, c);
+}
@@ -0,0 +1,36 @@
+#ifndef _KEY_REPLAY_H_
+#define _KEY_REPLAY_H_
+
+#include <stdio.h>
+#include "ShadowLCD.h"
+#include "MenuNavigator.h"
+#include "ButtonInput.h"
+
+// Drives a menu from a key script on a (usually headless) ShadowLCD and
+// reports what every step cost on the LCD bus, so that paint regressions
+// show up as numbers in CI. The script has one key per character: d u e
+// for down, up and enter, D U E for the held versions; blanks are skipped
+// and '#' comments out the rest of the line.
+class KeyReplay
+{
+public:
+	KeyReplay(ShadowLCD *lcd, Screen *screen, MenuNavigator *navigator);
+	// writes a tab separated report: a line for the initial paint, one per
+	// key, the totals and the final frame; false on a bad key
+	bool run(FILE *script, FILE *report);
+	const ShadowLCD::Counters &getTotals() const { return _totals; }
+	uint16_t getSteps() const { return _steps; }
+
+private:
+	void step(char key, FILE *report);
+
+	ShadowLCD *_lcd;
+	Screen *_screen;
+	MenuNavigator *_navigator;
+	ButtonEventQueue _queue;
+	ButtonDispatcher _dispatcher;
+	ShadowLCD::Counters _totals;
+	uint16_t _steps;
+};
+
+#endif
@@ -43,17 +43,34 @@ void LCD::begin(uint8_t cols, uint8_t lines, uint8_t dotsize)
 // ---------------------------------------------------------------------------
 void LCD::clear()
 {
-	_core->ClearScreen();
+	command(LCD_CLEARDISPLAY);
 }
 
 void LCD::home()
 {
-	setCursor(0, 0);
+	command(LCD_RETURNHOME);
 }
 
 void LCD::setCursor(uint8_t col, uint8_t row)
 {
-	_core->CursorPosition(col, row);
+   const uint8_t row_offsetsDef[]   = { 0x00, 0x40, 0x14, 0x54 }; // For regular LCDs
+   const uint8_t row_offsetsLarge[] = { 0x00, 0x40, 0x10, 0x50 }; // For 16x4 LCDs
+
+   if ( row >= _numlines )
+   {
+      row = _numlines-1;    // rows start at 0
+   }
+
+   // 16x4 LCDs have special memory map layout
+   // ----------------------------------------
+   if ( _cols == 16 && _numlines == 4 )
+   {
+      command(LCD_SETDDRAMADDR | (col + row_offsetsLarge[row]));
+   }
+   else
+   {
+      command(LCD_SETDDRAMADDR | (col + row_offsetsDef[row]));
+   }
 }
 
 // Turn the display on/off
@@ -168,12 +185,40 @@ void LCD::off ( void )
 #if (ARDUINO <  100)
 void LCD::write(uint8_t value)
 {
+   send(value, DATA);
 }
 #else
 size_t LCD::write(uint8_t value) 
 {
-	char s[2] = {value, 0};
-	_core->Prints(s);
+   send(value, DATA);
    return 1;             // assume OK
 }
 #endif
+
+void LCD::command(uint8_t value) 
+{
+   send(value, COMMAND);
+}
+
+void LCD::send(uint8_t value, uint8_t mode)
+{
+	if (mode == DATA) {
+		char s[2] = {value, 0};
+		_core->Prints(s);
+	} else if (value == LCD_CLEARDISPLAY) {
+		_core->ClearScreen();
+	} else if (value == LCD_RETURNHOME) {
+		_core->CursorPosition(0, 0);
+	} else if (value & LCD_SETDDRAMADDR) {
+		// inverse of the row offsets used by setCursor()
+		uint8_t addr = value & ~LCD_SETDDRAMADDR;
+		uint8_t split = (_cols == 16 && _numlines == 4) ? 0x10 : 0x14;
+		uint8_t row = addr >= 0x40 ? 1 : 0;
+		uint8_t col = addr - (row ? 0x40 : 0x00);
+		if (_numlines > 2 && col >= split) {
+			row += 2;
+			col -= split;
+		}
+		_core->CursorPosition(col, row);
+	}
+}
@@ -4,6 +4,17 @@
 #include <inttypes.h>
 #include <Print.h>
 
+// LCD Commands
+// ---------------------------------------------------------------------------
+#define LCD_CLEARDISPLAY        0x01
+#define LCD_RETURNHOME          0x02
+#define LCD_ENTRYMODESET        0x04
+#define LCD_DISPLAYCONTROL      0x08
+#define LCD_CURSORSHIFT         0x10
+#define LCD_FUNCTIONSET         0x20
+#define LCD_SETCGRAMADDR        0x40
+#define LCD_SETDDRAMADDR        0x80
+
 // flags for display entry mode
 // ---------------------------------------------------------------------------
 #define LCD_ENTRYRIGHT          0x00
@@ -401,6 +412,23 @@ protected:
    t_backlighPol _polarity;   // Backlight polarity
 
 private:
+   /*!
+    @function
+    @abstract   Send a command to the LCD.
+    @discussion As in LCD.h: clear(), home() and setCursor() are encoded as
+    HD44780 commands and go through send().
+    */
+   void command(uint8_t value);
+
+   /*!
+    @function
+    @abstract   Send a particular value to the LCD.
+    @discussion As in LCD.h this is where every command and data byte ends
+    up, so that derived classes can intercept the traffic. The mock decodes
+    it into console output.
+    */
+   virtual void send(uint8_t value, uint8_t mode);
+
 	ConsoleCore* _core;
 };
 
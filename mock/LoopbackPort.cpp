@@ -0,0 +1,64 @@
+#include <string.h>
+#include "LoopbackPort.h"
+
+LoopbackPort::LoopbackPort()
+: _inputHead(0),
+	_inputLength(0),
+	_replyLength(0),
+	_truncated(false)
+{
+	_reply[0] = '\0';
+}
+
+bool LoopbackPort::send(const char *bytes)
+{
+	assert(bytes != NULL);
+	size_t length = strlen(bytes);
+	if (_inputHead > 0) {
+		// what was read is dropped, the rest moves to the front
+		memmove(_input, _input + _inputHead, _inputLength);
+		_inputHead = 0;
+	}
+	if (length > static_cast<size_t>(INPUT_SIZE - _inputLength)) {
+		return false;
+	}
+	memcpy(_input + _inputLength, bytes, length);
+	_inputLength += static_cast<uint16_t>(length);
+	return true;
+}
+
+int LoopbackPort::read()
+{
+	if (_inputLength == 0) {
+		return -1;
+	}
+	_inputLength--;
+	return static_cast<uint8_t>(_input[_inputHead++]);
+}
+
+size_t LoopbackPort::write(uint8_t c)
+{
+	if (_replyLength == REPLY_SIZE) {
+		_truncated = true;
+		return 0;
+	}
+	_reply[_replyLength++] = static_cast<char>(c);
+	_reply[_replyLength] = '\0';
+	return 1;
+}
+
+size_t LoopbackPort::write(const uint8_t *buffer, size_t size)
+{
+	size_t n = 0;
+	while (n < size && write(buffer[n]) == 1) {
+		++n;
+	}
+	return n;
+}
+
+void LoopbackPort::clearReply()
+{
+	_replyLength = 0;
+	_reply[0] = '\0';
+	_truncated = false;
+}
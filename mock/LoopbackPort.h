@@ -0,0 +1,34 @@
+#ifndef _LOOPBACK_PORT_H_
+#define _LOOPBACK_PORT_H_
+
+#include "SerialControl.h"
+
+// SerialControl port in memory: send() queues the bytes a host would
+// write for read(), and what SerialControl prints collects in getReply()
+// until clearReply(). Lets tests run frames through poll() without a pipe.
+class LoopbackPort : public ByteSource, public Print
+{
+public:
+	enum {
+		INPUT_SIZE = 256,
+		REPLY_SIZE = 256
+	};
+	LoopbackPort();
+	bool send(const char *bytes); // false, queuing nothing, if they do not fit
+	int read();
+	size_t write(uint8_t c);
+	size_t write(const uint8_t *buffer, size_t size);
+	const char *getReply() const { return _reply; }
+	bool isReplyTruncated() const { return _truncated; }
+	void clearReply();
+
+private:
+	char _input[INPUT_SIZE];
+	uint16_t _inputHead;
+	uint16_t _inputLength;
+	char _reply[REPLY_SIZE + 1];
+	uint16_t _replyLength;
+	bool _truncated;
+};
+
+#endif
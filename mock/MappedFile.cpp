@@ -0,0 +1,40 @@
+#include "MappedFile.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <stddef.h>
+
+MappedFile::MappedFile(const char *path)
+: _data(NULL),
+	_size(0),
+	_mapping(NULL)
+{
+	_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+	if (_file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	DWORD size = GetFileSize(_file, NULL);
+	if (size > 0 && size != INVALID_FILE_SIZE) {
+		_mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (_mapping != NULL) {
+		_data = static_cast<const uint8_t *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (_data != NULL) {
+		_size = size;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (_data != NULL) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != NULL) {
+		CloseHandle(_mapping);
+	}
+	if (_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(_file);
+	}
+}
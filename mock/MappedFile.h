@@ -0,0 +1,23 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <stdint.h>
+
+// Read-only view of a whole file, e.g. a MenuSnapshot blob to load in
+// place like one stored in flash on the target
+class MappedFile
+{
+public:
+	explicit MappedFile(const char *path);
+	~MappedFile();
+	const uint8_t *getData() const { return _data; } // NULL if not mapped
+	uint32_t getSize() const { return _size; }
+
+private:
+	const uint8_t *_data;
+	uint32_t _size;
+	void *_file;
+	void *_mapping;
+};
+
+#endif
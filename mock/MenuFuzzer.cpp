@@ -0,0 +1,108 @@
+#include <string.h>
+#include "MenuFuzzer.h"
+
+static const char keys[BUTTON_PRESS_COUNT] = { 'd', 'u', 'e', 'D', 'U', 'E' };
+
+MenuFuzzer::MenuFuzzer(ShadowLCD *lcd, Screen *screen, MenuNavigator *navigator,
+	ShadowLCD *refLcd, Screen *refScreen)
+: _lcd(lcd),
+	_screen(screen),
+	_navigator(navigator),
+	_refLcd(refLcd),
+	_refScreen(refScreen),
+	_dispatcher(&_queue, NULL),
+	_state(1),
+	_events(0)
+{
+	assert(lcd != NULL);
+	assert(screen != NULL);
+	assert(navigator != NULL);
+	assert(refLcd != NULL);
+	assert(refScreen != NULL);
+	assert(refScreen->getCols() == screen->getCols() && refScreen->getRows() == screen->getRows());
+}
+
+// xorshift32, the same sequence on every platform
+uint32_t MenuFuzzer::random()
+{
+	_state ^= _state << 13;
+	_state ^= _state >> 17;
+	_state ^= _state << 5;
+	return _state;
+}
+
+bool MenuFuzzer::run(uint32_t events, uint32_t seed, FILE *report)
+{
+	assert(report != NULL);
+	_state = seed != 0 ? seed : 1;
+	_events = 0;
+	memset(_history, 0, sizeof(_history));
+	_navigator->getPage()->paint(_screen);
+	while (_events < events) {
+		ButtonPress button = static_cast<ButtonPress>(random() % BUTTON_PRESS_COUNT);
+		_history[_events % HISTORY] = keys[button];
+		_events++;
+		_queue.push(button, false, 0);
+		_queue.push(button, true, 0);
+		Page *page = _navigator->getPage();
+		_navigator->handleResult(_dispatcher.dispatch(page, _screen, 0));
+		_navigator->getPage()->refresh(_screen);
+		_dispatcher.endInput();
+		const char *failure = check();
+		if (failure != NULL) {
+			printFailure(failure, report);
+			return false;
+		}
+	}
+	return true;
+}
+
+// what is broken, NULL if nothing
+const char *MenuFuzzer::check()
+{
+	Page *page = _navigator->getPage();
+	const ScrollablePage *scrollable = dynamic_cast<const ScrollablePage *>(page);
+	if (scrollable != NULL) {
+		uint8_t rows = _screen->getRows();
+		if (scrollable->getCursorRow() >= rows || scrollable->getCurIdx() > scrollable->getMaxLines()) {
+			return "cursor out of range";
+		}
+		if (scrollable->getTopIndex() > 0 && scrollable->getTopIndex() + rows > scrollable->getMaxLines() + 1) {
+			return "scrolled past the last line";
+		}
+	}
+	const PropertyPage *properties = dynamic_cast<const PropertyPage *>(page);
+	if (properties != NULL) {
+		uint8_t focusLine = properties->getFocusLine();
+		for (uint8_t i = 0; i < properties->getLineCount(); ++i) {
+			const Property *p = properties->getProperty(i);
+			uint8_t part = p->getFocusPart();
+			if (part > p->getMaxFocusParts()) {
+				return "focus part out of range";
+			}
+			if ((part != 0) != (i == focusLine)) {
+				return "focus not on the focused line";
+			}
+		}
+	}
+	page->paint(_refScreen);
+	if (memcmp(_lcd->getFrame(), _refLcd->getFrame(), _lcd->getFrameSize()) != 0) {
+		return "frame differs from a full repaint";
+	}
+	return NULL;
+}
+
+void MenuFuzzer::printFailure(const char *what, FILE *report) const
+{
+	fprintf(report, "event %lu: %s\nlast presses: ", static_cast<unsigned long>(_events), what);
+	uint32_t first = _events > HISTORY ? _events - HISTORY : 0;
+	for (uint32_t i = first; i < _events; ++i) {
+		fputc(_history[i % HISTORY], report);
+	}
+	fputc('\n', report);
+	for (uint8_t r = 0; r < _lcd->getRows(); ++r) {
+		fprintf(report, "shown  |%.*s|\nrepaint|%.*s|\n",
+			_lcd->getCols(), _lcd->getFrame() + r * _lcd->getCols(),
+			_refLcd->getCols(), _refLcd->getFrame() + r * _refLcd->getCols());
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef _MENU_FUZZER_H_
+#define _MENU_FUZZER_H_
+
+#include <stdio.h>
+#include "ShadowLCD.h"
+#include "MenuNavigator.h"
+#include "ButtonInput.h"
+
+// Fires random button presses, held ones included, at a menu and checks
+// after each one that:
+// - the cursor of a ScrollablePage is on a line and no row is left blank
+//   by scrolling
+// - a PropertyPage edits at most the property at getFocusLine(), with a
+//   focus part in range
+// - the frame left by the partial repaints equals a full Page::paint() on
+//   a second display
+// The sequence depends on the seed only, so that a failure is replayed by
+// running the same seed again.
+class MenuFuzzer
+{
+public:
+	enum {
+		HISTORY = 32 // presses printed when an invariant fails
+	};
+	// refLcd and refScreen receive the full repaints, of the same size
+	MenuFuzzer(ShadowLCD *lcd, Screen *screen, MenuNavigator *navigator,
+		ShadowLCD *refLcd, Screen *refScreen);
+	// false, with a report of the failure, when an invariant breaks
+	bool run(uint32_t events, uint32_t seed, FILE *report);
+	uint32_t getEvents() const { return _events; }
+
+private:
+	uint32_t random();
+	const char *check();
+	void printFailure(const char *what, FILE *report) const;
+
+	ShadowLCD *_lcd;
+	Screen *_screen;
+	MenuNavigator *_navigator;
+	ShadowLCD *_refLcd;
+	Screen *_refScreen;
+	ButtonEventQueue _queue;
+	ButtonDispatcher _dispatcher;
+	uint32_t _state;
+	uint32_t _events;
+	uint8_t _history[HISTORY];
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include <string.h>
+#include "MicroBench.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+MicroBench::MicroBench(ShadowLCD *lcd)
+: _lcd(lcd),
+	_count(0)
+{
+	assert(lcd != NULL);
+}
+
+double MicroBench::nowNs()
+{
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return static_cast<double>(counter.QuadPart) * 1e9 / static_cast<double>(frequency.QuadPart);
+}
+
+void MicroBench::run(const char *name, Body body, uint32_t iterations)
+{
+	assert(_count < MAX_CASES);
+	assert(iterations > 0);
+	// warm up caches and branch predictors
+	for (uint32_t i = 0; i < iterations / 10; ++i) {
+		body();
+	}
+	_lcd->resetCounters();
+	double start = nowNs();
+	for (uint32_t i = 0; i < iterations; ++i) {
+		body();
+	}
+	double elapsed = nowNs() - start;
+	const ShadowLCD::Counters &c = _lcd->getCounters();
+	Result &r = _results[_count++];
+	r.name = name;
+	r.nsPerOp = elapsed / iterations;
+	r.bytesPerOp = static_cast<double>(c.commands + c.dataBytes) / iterations;
+}
+
+void MicroBench::report(FILE *out) const
+{
+	fprintf(out, "%-24s %12s %12s\n", "case", "ns/op", "bytes/op");
+	for (uint8_t i = 0; i < _count; ++i) {
+		const Result &r = _results[i];
+		fprintf(out, "%-24s %12.1f %12.2f\n", r.name, r.nsPerOp, r.bytesPerOp);
+	}
+}
+
+bool MicroBench::save(const char *path) const
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		return false;
+	}
+	fprintf(f, "# case\tns_per_op\tbytes_per_op\n");
+	for (uint8_t i = 0; i < _count; ++i) {
+		const Result &r = _results[i];
+		fprintf(f, "%s\t%.1f\t%.2f\n", r.name, r.nsPerOp, r.bytesPerOp);
+	}
+	fclose(f);
+	return true;
+}
+
+bool MicroBench::compare(const char *path, FILE *out) const
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		return false;
+	}
+	fprintf(out, "%-24s %12s %12s\n", "case", "time", "bytes");
+	char line[128];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char name[64];
+		double ns;
+		double bytes;
+		if (line[0] == '#' || sscanf(line, "%63s %lf %lf", name, &ns, &bytes) != 3) {
+			continue;
+		}
+		for (uint8_t i = 0; i < _count; ++i) {
+			const Result &r = _results[i];
+			if (strcmp(r.name, name) == 0) {
+				fprintf(out, "%-24s %+11.1f%% %+12.2f\n", name,
+					ns > 0 ? (r.nsPerOp - ns) * 100 / ns : 0.0, r.bytesPerOp - bytes);
+			}
+		}
+	}
+	fclose(f);
+	return true;
+}
@@ -0,0 +1,38 @@
+#ifndef _MICRO_BENCH_H_
+#define _MICRO_BENCH_H_
+
+#include <stdio.h>
+#include "ShadowLCD.h"
+
+// Fixed-iteration timing loops for the paint and formatting paths. Every
+// case reports ns per operation and the LCD traffic (commands and data
+// bytes) it produced; results are saved as a tab separated file that a
+// later run compares against.
+class MicroBench
+{
+public:
+	typedef void (*Body)(void);
+	enum {
+		MAX_CASES = 24
+	};
+	explicit MicroBench(ShadowLCD *lcd);
+	void run(const char *name, Body body, uint32_t iterations);
+	void report(FILE *out) const;
+	bool save(const char *path) const;
+	// prints the change of every case against a file written by save()
+	bool compare(const char *path, FILE *out) const;
+
+private:
+	struct Result {
+		const char *name;
+		double nsPerOp;
+		double bytesPerOp;
+	};
+	static double nowNs();
+
+	ShadowLCD *_lcd;
+	Result _results[MAX_CASES];
+	uint8_t _count;
+};
+
+#endif
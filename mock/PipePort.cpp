@@ -0,0 +1,61 @@
+#include "PipePort.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+PipePort::PipePort(const char *name)
+: _name(name)
+{
+	_pipe = CreateNamedPipeA(name, PIPE_ACCESS_DUPLEX,
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_NOWAIT, 1, 256, 256, 0, NULL);
+}
+
+PipePort::~PipePort()
+{
+	if (_pipe != INVALID_HANDLE_VALUE) {
+		CloseHandle(_pipe);
+	}
+}
+
+bool PipePort::isOpen() const
+{
+	return _pipe != INVALID_HANDLE_VALUE;
+}
+
+int PipePort::read()
+{
+	if (_pipe == INVALID_HANDLE_VALUE) {
+		return -1;
+	}
+	// with PIPE_NOWAIT this only starts listening; it fails harmlessly
+	// while a client is connected
+	ConnectNamedPipe(_pipe, NULL);
+	DWORD available = 0;
+	if (!PeekNamedPipe(_pipe, NULL, 0, NULL, &available, NULL)) {
+		if (GetLastError() == ERROR_BROKEN_PIPE) {
+			// the client went away: listen for the next one
+			DisconnectNamedPipe(_pipe);
+		}
+		return -1;
+	}
+	uint8_t c;
+	DWORD n = 0;
+	if (available > 0 && ReadFile(_pipe, &c, 1, &n, NULL) && n == 1) {
+		return c;
+	}
+	return -1;
+}
+
+size_t PipePort::write(uint8_t c)
+{
+	return write(&c, 1);
+}
+
+size_t PipePort::write(const uint8_t *buffer, size_t size)
+{
+	DWORD n = 0;
+	if (_pipe == INVALID_HANDLE_VALUE || !WriteFile(_pipe, buffer, static_cast<DWORD>(size), &n, NULL)) {
+		return 0;
+	}
+	return n;
+}
@@ -0,0 +1,26 @@
+#ifndef _PIPE_PORT_H_
+#define _PIPE_PORT_H_
+
+#include "SerialControl.h"
+
+// Host stand-in for the UART of SerialControl: a named pipe server whose
+// client end (getName(), \\.\pipe\PropertyMenu) a test or a configuration
+// tool opens like a serial port. Never blocks; a client that goes away can
+// be replaced by the next one.
+class PipePort : public ByteSource, public Print
+{
+public:
+	explicit PipePort(const char *name);
+	~PipePort();
+	bool isOpen() const;
+	const char *getName() const { return _name; }
+	int read();
+	size_t write(uint8_t c);
+	size_t write(const uint8_t *buffer, size_t size);
+
+private:
+	const char *_name;
+	void *_pipe;
+};
+
+#endif
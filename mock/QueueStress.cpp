@@ -0,0 +1,100 @@
+#include "QueueStress.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+// payload derived from the sequence number, to catch slots read while
+// being written
+static ButtonPress buttonOf(uint32_t sequence)
+{
+	return static_cast<ButtonPress>(sequence % BUTTON_PRESS_COUNT);
+}
+
+static bool releasedOf(uint32_t sequence)
+{
+	return ((sequence / BUTTON_PRESS_COUNT) & 1) != 0;
+}
+
+QueueStress::QueueStress()
+: _events(0),
+	_received(0),
+	_refused(0),
+	_produced(false)
+{
+}
+
+unsigned long __stdcall QueueStress::produce(void *stress)
+{
+	QueueStress *s = static_cast<QueueStress *>(stress);
+	for (uint32_t i = 0; i < s->_events; ++i) {
+		if (!s->_queue.push(buttonOf(i), releasedOf(i), i)) {
+			// the event is lost; let the consumer catch up so that the
+			// run is not all refusals
+			s->_refused++;
+			while (!s->_queue.isEmpty()) {
+				SwitchToThread();
+			}
+		}
+	}
+	BUTTON_QUEUE_BARRIER();
+	s->_produced = true;
+	return 0;
+}
+
+bool QueueStress::run(uint32_t events, FILE *report)
+{
+	assert(report != NULL);
+	_events = events;
+	_received = 0;
+	_refused = 0;
+	_produced = false;
+	HANDLE producer = CreateThread(NULL, 0, produce, this, 0, NULL);
+	if (producer == NULL) {
+		fprintf(report, "stress: cannot start the producer thread\n");
+		return false;
+	}
+	const char *failure = NULL;
+	uint32_t expected = 0;
+	uint32_t missing = 0;
+	ButtonEvent e;
+	for (;;) {
+		// read before popping: once set, an empty queue means the end
+		bool produced = _produced;
+		BUTTON_QUEUE_BARRIER();
+		if (!_queue.pop(&e)) {
+			if (produced) {
+				break;
+			}
+			SwitchToThread();
+			continue;
+		}
+		if (failure != NULL) {
+			continue; // keep draining so that the producer can end
+		}
+		if (e.time < expected || e.time >= events) {
+			failure = "event out of order or duplicated";
+		} else if (e.button != buttonOf(e.time) || e.released != releasedOf(e.time)) {
+			failure = "event payload torn";
+		} else {
+			missing += e.time - expected;
+			expected = e.time + 1;
+			_received++;
+		}
+		if (failure != NULL) {
+			fprintf(report, "stress: %s at event %lu, expected %lu\n", failure,
+				static_cast<unsigned long>(e.time), static_cast<unsigned long>(expected));
+		}
+	}
+	WaitForSingleObject(producer, INFINITE);
+	CloseHandle(producer);
+	if (failure != NULL) {
+		return false;
+	}
+	missing += events - expected;
+	if (missing != _refused || _received + _refused != events) {
+		fprintf(report, "stress: %lu events lost, the queue refused %lu\n",
+			static_cast<unsigned long>(missing), static_cast<unsigned long>(_refused));
+		return false;
+	}
+	return true;
+}
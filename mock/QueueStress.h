@@ -0,0 +1,33 @@
+#ifndef _QUEUE_STRESS_H_
+#define _QUEUE_STRESS_H_
+
+#include <stdio.h>
+#include "ButtonInput.h"
+
+// Runs a ButtonEventQueue across two threads: a producer thread pushes
+// sequence numbered events as fast as it can, like a pin-change ISR that
+// never retries, while the calling thread pops them like loop(). After a
+// refused push the producer waits for the queue to drain. Checks that
+// every event arrives once, in order and with the payload written for its
+// sequence number, and that the events missing are exactly the pushes the
+// queue refused because it was full.
+class QueueStress
+{
+public:
+	QueueStress();
+	// false, with a report of the first failure, when a check breaks
+	bool run(uint32_t events, FILE *report);
+	uint32_t getReceived() const { return _received; }
+	uint32_t getRefused() const { return _refused; }
+
+private:
+	static unsigned long __stdcall produce(void *stress);
+
+	ButtonEventQueue _queue;
+	uint32_t _events;
+	uint32_t _received;
+	uint32_t _refused; // written by the producer, read after it has ended
+	volatile bool _produced;
+};
+
+#endif
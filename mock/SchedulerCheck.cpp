@@ -0,0 +1,172 @@
+#include "SchedulerCheck.h"
+
+// the simulated millis(), moved forward by the checks and by slow tasks
+static uint32_t simNow;
+
+static uint32_t simClock()
+{
+	return simNow;
+}
+
+// run times of the tasks, in order
+enum {
+	MAX_RUNS = 64
+};
+static uint32_t runTimes[MAX_RUNS];
+static char runTasks[MAX_RUNS];
+static uint8_t runCount;
+static uint32_t taskCost; // ms each task call takes
+
+static void record(char task)
+{
+	if (runCount < MAX_RUNS) {
+		runTimes[runCount] = simNow;
+		runTasks[runCount] = task;
+		++runCount;
+	}
+	simNow += taskCost;
+}
+
+static void taskA()
+{
+	record('A');
+}
+
+static void taskB()
+{
+	record('B');
+}
+
+static void resetRuns(uint32_t now)
+{
+	simNow = now;
+	runCount = 0;
+	taskCost = 0;
+}
+
+SchedulerCheck::SchedulerCheck()
+: _report(NULL),
+	_checks(0),
+	_failures(0)
+{
+}
+
+bool SchedulerCheck::run(FILE *report)
+{
+	assert(report != NULL);
+	_report = report;
+	_checks = 0;
+	_failures = 0;
+	checkDrift();
+	checkStall();
+	checkWraparound();
+	checkNextDeadline();
+	checkBudget();
+	return _failures == 0;
+}
+
+void SchedulerCheck::expect(bool ok, const char *what, uint32_t got, uint32_t expected)
+{
+	++_checks;
+	if (!ok) {
+		++_failures;
+		fprintf(_report, "scheduler: %s: got %lu, expected %lu\n", what,
+			static_cast<unsigned long>(got), static_cast<unsigned long>(expected));
+	}
+}
+
+void SchedulerCheck::checkDrift()
+{
+	// the loop comes round every 37 ms and the task costs 5 ms, so every
+	// run is late; the deadlines must stay on the 100 ms grid regardless
+	resetRuns(1000);
+	taskCost = 5;
+	TaskScheduler scheduler(simClock);
+	scheduler.add(taskA, 100);
+	while (simNow < 1000 + 100 * 50) {
+		scheduler.runDue(10);
+		uint32_t next = simNow + scheduler.getTimeToNext(simNow);
+		uint32_t grid = 1000 + 100UL * runCount;
+		expect(next == grid, "drift: next deadline", next, grid);
+		simNow += 37;
+	}
+	expect(runCount == 50, "drift: runs in 5 s", runCount, 50);
+	for (uint8_t i = 0; i < runCount; ++i) {
+		uint32_t late = runTimes[i] - (1000 + 100UL * i);
+		expect(late < 37 + 5, "drift: run lateness", late, 0);
+	}
+}
+
+void SchedulerCheck::checkStall()
+{
+	// ten periods missed run the task once, then the grid restarts from now
+	resetRuns(0);
+	TaskScheduler scheduler(simClock);
+	scheduler.add(taskA, 100);
+	scheduler.runDue(10);
+	simNow = 1050;
+	scheduler.runDue(10);
+	expect(runCount == 2, "stall: runs after 10 missed periods", runCount, 2);
+	expect(scheduler.getTimeToNext(simNow) == 100, "stall: time to next run",
+		scheduler.getTimeToNext(simNow), 100);
+}
+
+void SchedulerCheck::checkWraparound()
+{
+	// A every 100 ms from 200 ms before the wraparound, B once 250 ms later
+	const uint32_t start = 0xffffffffUL - 199;
+	resetRuns(start);
+	TaskScheduler scheduler(simClock);
+	scheduler.add(taskA, 100);
+	scheduler.add(taskB, 0, 250);
+	for (uint32_t t = 0; t <= 400; t += 10) {
+		simNow = start + t;
+		scheduler.runDue(10);
+	}
+	static const char order[] = "AAABAA";
+	static const uint16_t offsets[] = { 0, 100, 200, 250, 300, 400 };
+	expect(runCount == 6, "wraparound: runs", runCount, 6);
+	for (uint8_t i = 0; i < runCount && i < 6; ++i) {
+		expect(runTasks[i] == order[i], "wraparound: task order", runTasks[i], order[i]);
+		expect(runTimes[i] == start + offsets[i], "wraparound: run time",
+			runTimes[i] - start, offsets[i]);
+	}
+	// 10 ms before the wraparound, A is next 10 ms after it
+	simNow = 0xffffffffUL - 9;
+	TaskScheduler wrapped(simClock);
+	wrapped.add(taskA, 100, 20);
+	expect(wrapped.getTimeToNext(simNow) == 20, "wraparound: time to next",
+		wrapped.getTimeToNext(simNow), 20);
+}
+
+void SchedulerCheck::checkNextDeadline()
+{
+	resetRuns(5000);
+	TaskScheduler scheduler(simClock);
+	expect(scheduler.getTimeToNext(simNow) == TaskScheduler::WAIT_FOREVER,
+		"next: without tasks", scheduler.getTimeToNext(simNow), TaskScheduler::WAIT_FOREVER);
+	scheduler.add(taskA, 100, 50);
+	TaskScheduler::TaskId b = scheduler.add(taskB, 100, 20);
+	expect(scheduler.getTimeToNext(simNow) == 20, "next: earliest of two",
+		scheduler.getTimeToNext(simNow), 20);
+	scheduler.remove(b);
+	expect(scheduler.getTimeToNext(simNow) == 50, "next: after remove",
+		scheduler.getTimeToNext(simNow), 50);
+	expect(scheduler.getTimeToNext(simNow + 50) == 0, "next: due",
+		scheduler.getTimeToNext(simNow + 50), 0);
+	expect(scheduler.getTimeToNext(simNow + 80) == 0, "next: overdue",
+		scheduler.getTimeToNext(simNow + 80), 0);
+}
+
+void SchedulerCheck::checkBudget()
+{
+	// three due tasks of 6 ms each in a 10 ms budget: two run now
+	resetRuns(0);
+	taskCost = 6;
+	TaskScheduler scheduler(simClock);
+	scheduler.add(taskA, 0);
+	scheduler.add(taskB, 0);
+	scheduler.add(taskA, 0);
+	expect(scheduler.runDue(10) == 2, "budget: tasks run", runCount, 2);
+	expect(scheduler.runDue(0) == 1, "budget: one task on no budget", runCount, 3);
+}
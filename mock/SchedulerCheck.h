@@ -0,0 +1,38 @@
+#ifndef _SCHEDULER_CHECK_H_
+#define _SCHEDULER_CHECK_H_
+
+#include <stdio.h>
+#include "TaskScheduler.h"
+
+// Drives a TaskScheduler from a simulated ClockCallback, so that hours of
+// millis() pass in microseconds, and checks that:
+// - a periodic task keeps its phase: deadlines advance by the period, not
+//   by when the task happened to run, and a stall skips the missed runs
+//   instead of bursting them
+// - deadlines on both sides of the millis() wraparound run in order and
+//   on time
+// - getTimeToNext() is the time to the earliest deadline, 0 once it is
+//   due and WAIT_FOREVER without tasks
+// - runDue() stops at its budget but always runs one due task
+class SchedulerCheck
+{
+public:
+	SchedulerCheck();
+	// false, with a line for every failed check, if any failed
+	bool run(FILE *report);
+	uint16_t getChecks() const { return _checks; }
+
+private:
+	void checkDrift();
+	void checkStall();
+	void checkWraparound();
+	void checkNextDeadline();
+	void checkBudget();
+	void expect(bool ok, const char *what, uint32_t got, uint32_t expected);
+
+	FILE *_report;
+	uint16_t _checks;
+	uint16_t _failures;
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include <string.h>
+#include "SerialCheck.h"
+#include "ShadowLCD.h"
+#include "ChangeTracker.h"
+
+// the menu driven by the frames: Setup/Time, On, Level, Offset, Uptime
+MakeFlashString(LBL_CHECK_SETUP, "Setup");
+MakeFlashString(LBL_CHECK_TIME, "Time");
+MakeFlashString(LBL_CHECK_ON, "On");
+MakeFlashString(LBL_CHECK_LEVEL, "Level");
+MakeFlashString(LBL_CHECK_OFFSET, "Offset");
+MakeFlashString(LBL_CHECK_UPTIME, "Uptime");
+
+static PropertyTime::Time checkTime;
+static bool checkOn;
+static uint16_t checkLevel;
+static int16_t checkOffset;
+
+static int32_t checkUptime()
+{
+	return -42;
+}
+
+static PropertyTime checkTimeProp(LBL_CHECK_TIME, &checkTime);
+static PropertyBool checkOnProp(LBL_CHECK_ON, &checkOn);
+static PropertyU16 checkLevelProp(LBL_CHECK_LEVEL, &checkLevel, 0, 500);
+static PropertyInt<int16_t, -100, 100> checkOffsetProp(LBL_CHECK_OFFSET, &checkOffset);
+static PropertyLive checkUptimeProp(LBL_CHECK_UPTIME, checkUptime, 4);
+
+static Property *checkProperties[] = {
+	&checkTimeProp,
+	&checkOnProp,
+	&checkLevelProp,
+	&checkOffsetProp,
+	&checkUptimeProp,
+	NULL
+};
+
+static PropertyPage checkPropPage(checkProperties);
+static MenuItem checkSetupItem(LBL_CHECK_SETUP, &checkPropPage);
+
+static MenuItem *checkItems[] = {
+	&checkSetupItem,
+	NULL
+};
+
+static MenuItemPage checkRootPage(checkItems);
+
+static void resetValues()
+{
+	checkTime.hour = 7;
+	checkTime.mins = 30;
+	checkOn = false;
+	checkLevel = 100;
+	checkOffset = -5;
+}
+
+static uint8_t checkFlushes;
+
+static void countFlush(Property ** /*changed*/, uint8_t /*count*/, bool /*overflowed*/)
+{
+	checkFlushes++;
+}
+
+// frame or reply with its line endings visible
+static void printEscaped(FILE *f, const char *s)
+{
+	for (; *s != '\0'; ++s) {
+		if (*s == '\n') {
+			fputs("\\n", f);
+		} else if (*s == '\r') {
+			fputs("\\r", f);
+		} else {
+			fputc(*s, f);
+		}
+	}
+}
+
+SerialCheck::SerialCheck()
+: _index(_entries, INDEX_SIZE),
+	_control(&_port, &_port, &_index, _line, LINE_SIZE),
+	_report(NULL),
+	_frames(0),
+	_failures(0)
+{
+}
+
+bool SerialCheck::run(FILE *report)
+{
+	assert(report != NULL);
+	_report = report;
+	_frames = 0;
+	_failures = 0;
+	if (!_index.build(&checkRootPage)) {
+		fprintf(_report, "serial: menu index does not build\n");
+		return false;
+	}
+	resetValues();
+	checkReads();
+	checkWrites();
+	checkErrors();
+	checkBusy();
+	checkOverflow();
+	checkFraming();
+	checkJump();
+	return _failures == 0;
+}
+
+void SerialCheck::checkReads()
+{
+	expect("Setup/Time;Setup/On;Setup/Level;Setup/Offset;Setup/Uptime\n",
+		"OK 07:30;0;100;-5;-42\n", 0);
+	char frame[16];
+	sprintf(frame, "#%lx\n", static_cast<unsigned long>(MenuIndex::hashPath("Setup/Level")));
+	expect(frame, "OK 100\n", 0);
+}
+
+void SerialCheck::checkWrites()
+{
+	expect("Setup/Time=12:05;Setup/On=1;Setup/Offset=-100\n", "OK\n", 3);
+	expect("Setup/Time;Setup/On;Setup/Offset\n", "OK 12:05;1;-100\n", 0);
+	// a value set to what it already is does not count as changed
+	expect("Setup/Level=100;Setup/Level\n", "OK 100\n", 0);
+	char frame[24];
+	sprintf(frame, "#%lX=250\n", static_cast<unsigned long>(MenuIndex::hashPath("Setup/Level")));
+	expect(frame, "OK\n", 1);
+	expect("Setup/Level\n", "OK 250\n", 0);
+}
+
+void SerialCheck::checkErrors()
+{
+	expect("Setup/Nope\n", "ERR 1 unknown\n", 0);
+	expect("#123\n", "ERR 1 unknown\n", 0);
+	expect("Setup/Time=24:00\n", "ERR 1 value\n", 0);
+	expect("Setup/On=2\n", "ERR 1 value\n", 0);
+	expect("Setup/Level=501\n", "ERR 1 value\n", 0);
+	expect("Setup/Offset=-101\n", "ERR 1 value\n", 0);
+	expect("Setup/Uptime=1\n", "ERR 1 readonly\n", 0);
+	// the frame is applied entirely or not at all
+	expect("Setup/Level=7;Setup/On=0;Setup/Nope=1\n", "ERR 3 unknown\n", 0);
+	expect("Setup/Level=7;Setup/Time=1:61\n", "ERR 2 value\n", 0);
+	expect("Setup/Level;Setup/On;Setup/Time\n", "OK 250;1;12:05\n", 0);
+}
+
+void SerialCheck::checkBusy()
+{
+	checkPropPage.focusLine(2);
+	expect("Setup/Level=8\n", "ERR 1 busy\n", 0);
+	expect("Setup/On=0;Setup/Level=8\n", "ERR 2 busy\n", 0);
+	// reading is allowed while editing
+	expect("Setup/Level;Setup/On\n", "OK 250;1\n", 0);
+	checkPropPage.reset();
+	// a staged edit is not seen by the host until committed
+	char frame[SCREEN_COLS * SCREEN_ROWS];
+	ShadowLCD shadow(NULL, frame, sizeof(frame));
+	Screen screen(&shadow, SCREEN_COLS, SCREEN_ROWS);
+	checkPropPage.setStaged(true);
+	checkPropPage.focusLine(2);
+	checkPropPage.buttonInput(BUTTON_PRESS_UP, &screen);
+	expectTrue(checkLevelProp.isStaged() && *checkLevelProp.getVar() != checkLevel,
+		"staged edit leaves the variable");
+	expect("Setup/Level\n", "OK 250\n", 0);
+	checkPropPage.reset();
+	checkPropPage.setStaged(false);
+	expect("Setup/Level=8\n", "OK\n", 1);
+}
+
+void SerialCheck::checkOverflow()
+{
+	char frame[LINE_SIZE + 16];
+	memset(frame, 'x', LINE_SIZE + 1);
+	strcpy(frame + LINE_SIZE + 1, "\n");
+	expect(frame, "ERR 0 overflow\n", 0);
+	// the line is usable again, and nothing of the long frame is left in it
+	expect("Setup/Level\n", "OK 8\n", 0);
+	// exactly LINE_SIZE bytes still fit
+	static const char full[] = "Setup/Offset;Setup/Offset;Setup/Offset;Setup/Offset;Setup/Offset\n";
+	assert(sizeof(full) - 2 == LINE_SIZE);
+	expect(full, "OK -100;-100;-100;-100;-100\n", 0);
+}
+
+void SerialCheck::checkFraming()
+{
+	// nothing is replied before the end of the line
+	expect("Setup/Le", "", 0);
+	expect("vel=9", "", 0);
+	expect("\r\n", "OK\n", 1);
+	expect("\n\r\n", "", 0);
+	// two frames in one read, each replied to in turn
+	expect("Setup/Level\nSetup/On=0\n", "OK 9\nOK\n", 1);
+	expect("Setup/On\n", "OK 0\n", 0);
+}
+
+void SerialCheck::checkJump()
+{
+	char frame[SCREEN_COLS * SCREEN_ROWS];
+	ShadowLCD shadow(NULL, frame, sizeof(frame));
+	Screen screen(&shadow, SCREEN_COLS, SCREEN_ROWS);
+	MenuNavigator navigator(&screen, &checkRootPage);
+	expectJump(&navigator, "Setup/Uptime", &checkPropPage, 1, 4);
+	expectJump(&navigator, "Setup", &checkRootPage, 1, 0);
+	expectJump(&navigator, "Setup/Time", &checkPropPage, 1, 0);
+	Property *changed[2];
+	ChangeTracker tracker(changed, 2, countFlush);
+	ChangeTracker *previous = Property::getTracker();
+	Property::setTracker(&tracker);
+	// changed so far without a tracker
+	for (Property **p = checkProperties; *p != NULL; ++p) {
+		(*p)->clearDirty();
+	}
+	checkFlushes = 0;
+	// an edit in place ends and is reported when its page is left
+	expectJump(&navigator, "Setup/Level", &checkPropPage, 1, 2);
+	checkPropPage.buttonInput(BUTTON_PRESS_ENTER, &screen);
+	checkPropPage.buttonInput(BUTTON_PRESS_UP, &screen);
+	expectJump(&navigator, "Setup", &checkRootPage, 1, 0);
+	expectTrue(checkLevelProp.getFocusPart() == 0, "jump away ends an edit in place");
+	expectTrue(checkFlushes == 1, "jump away reports an edit in place");
+	expect("Setup/Level=8\n", "OK\n", 1);
+	// a staged edit is discarded, also when the page stays
+	checkPropPage.setStaged(true);
+	expectJump(&navigator, "Setup/Level", &checkPropPage, 1, 2);
+	checkPropPage.buttonInput(BUTTON_PRESS_ENTER, &screen);
+	checkPropPage.buttonInput(BUTTON_PRESS_UP, &screen);
+	expectJump(&navigator, "Setup/Time", &checkPropPage, 1, 0);
+	expectTrue(!checkLevelProp.isStaged() && checkLevelProp.getVar() == &checkLevel,
+		"jump unbinds the shadow of a staged edit");
+	expect("Setup/Level\n", "OK 8\n", 0);
+	checkPropPage.setStaged(false);
+	Property::setTracker(previous);
+}
+
+void SerialCheck::expect(const char *frame, const char *reply, uint8_t changed)
+{
+	_port.clearReply();
+	bool sent = _port.send(frame);
+	uint8_t got = _control.poll();
+	_frames++;
+	if (sent && !_port.isReplyTruncated() && strcmp(_port.getReply(), reply) == 0 && got == changed) {
+		return;
+	}
+	_failures++;
+	fputs("serial: \"", _report);
+	printEscaped(_report, frame);
+	fputs("\" replied \"", _report);
+	printEscaped(_report, _port.getReply());
+	fprintf(_report, "\" changing %u, expected \"", got);
+	printEscaped(_report, reply);
+	fprintf(_report, "\" changing %u\n", changed);
+}
+
+void SerialCheck::expectJump(MenuNavigator *navigator, const char *path, Page *page, uint8_t row, uint8_t top)
+{
+	bool jumped = _index.jump(navigator, MenuIndex::hashPath(path));
+	const ScrollablePage *shown = static_cast<const ScrollablePage *>(navigator->getPage());
+	if (jumped && shown == page && shown->getCursorRow() == row && shown->getTopIndex() == top) {
+		return;
+	}
+	_failures++;
+	fprintf(_report, "serial: jump to %s %s, cursor row %u top %u, expected row %u top %u\n",
+		path, !jumped ? "failed" : shown == page ? "shows the page" : "shows another page",
+		shown->getCursorRow(), shown->getTopIndex(), row, top);
+}
+
+void SerialCheck::expectTrue(bool ok, const char *what)
+{
+	if (!ok) {
+		_failures++;
+		fprintf(_report, "serial: not true that %s\n", what);
+	}
+}
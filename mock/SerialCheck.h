@@ -0,0 +1,57 @@
+#ifndef _SERIAL_CHECK_H_
+#define _SERIAL_CHECK_H_
+
+#include <stdio.h>
+#include "SerialControl.h"
+#include "LoopbackPort.h"
+
+// Runs scripted frames through SerialControl::poll() over a LoopbackPort,
+// against a small menu of its own, and checks every reply and the count of
+// values changed:
+// - reads and writes by path and by '#' ID, with "OK" and the values
+// - "ERR <item> unknown", "value" and "readonly", leaving every value of
+//   the frame as it was
+// - "busy" while the property is being edited on its page
+// - "ERR 0 overflow" for a frame longer than the line, and that the next
+//   frame is handled again
+// - frames split over several polls, CRLF endings and empty lines
+// - MenuIndex::jump() to a path: the page, cursor row and top index shown,
+//   and that the edit it interrupts ends, reported to the ChangeTracker
+//   when in place and discarded when staged
+class SerialCheck
+{
+public:
+	enum {
+		LINE_SIZE = 64,
+		INDEX_SIZE = 8,
+		SCREEN_COLS = 16,
+		SCREEN_ROWS = 2
+	};
+	SerialCheck();
+	// false, with a line for every failed frame, if any failed
+	bool run(FILE *report);
+	uint16_t getFrames() const { return _frames; }
+
+private:
+	void checkReads();
+	void checkWrites();
+	void checkErrors();
+	void checkBusy();
+	void checkOverflow();
+	void checkFraming();
+	void checkJump();
+	void expect(const char *frame, const char *reply, uint8_t changed);
+	void expectJump(MenuNavigator *navigator, const char *path, Page *page, uint8_t row, uint8_t top);
+	void expectTrue(bool ok, const char *what);
+
+	LoopbackPort _port;
+	MenuIndex::Entry _entries[INDEX_SIZE];
+	MenuIndex _index;
+	char _line[LINE_SIZE];
+	SerialControl _control;
+	FILE *_report;
+	uint16_t _frames;
+	uint16_t _failures;
+};
+
+#endif
@@ -20,6 +20,7 @@
 */
 
 #include "WString.h"
+#include "HeapTracker.h"
 
 
 /*********************************************/
@@ -102,7 +103,7 @@ String::String(unsigned long value, unsigned char base)
 
 String::~String()
 {
-	free(buffer);
+	releaseBuffer();
 }
 
 /*********************************************/
@@ -117,9 +118,14 @@ inline void String::init(void)
 	flags = 0;
 }
 
+void String::releaseBuffer(void)
+{
+	if (buffer && !isInline()) HeapTracker::release(buffer);
+}
+
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	releaseBuffer();
 	buffer = NULL;
 	capacity = len = 0;
 }
@@ -136,7 +142,21 @@ unsigned char String::reserve(unsigned int size)
 
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	if (!buffer && maxStrLen <= SSO_CAPACITY) {
+		buffer = inline_buffer;
+		capacity = SSO_CAPACITY;
+		return 1;
+	}
+	if (isInline()) {
+		if (maxStrLen <= SSO_CAPACITY) return 1;
+		char *newbuffer = (char *)HeapTracker::reallocate(NULL, maxStrLen + 1);
+		if (!newbuffer) return 0;
+		memcpy(newbuffer, inline_buffer, len + 1);
+		buffer = newbuffer;
+		capacity = maxStrLen;
+		return 1;
+	}
+	char *newbuffer = (char *)HeapTracker::reallocate(buffer, maxStrLen + 1);
 	if (newbuffer) {
 		buffer = newbuffer;
 		capacity = maxStrLen;
@@ -170,9 +190,15 @@ void String::move(String &rhs)
 			rhs.len = 0;
 			return;
 		} else {
-			free(buffer);
+			releaseBuffer();
+			buffer = NULL;
 		}
 	}
+	if (rhs.isInline()) {
+		// the inline buffer cannot be taken over
+		copy(rhs.buffer, rhs.len);
+		return;
+	}
 	buffer = rhs.buffer;
 	capacity = rhs.capacity;
 	len = rhs.len;
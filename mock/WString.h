@@ -172,12 +172,19 @@ public:
 	long toInt(void) const;
 
 protected:
-	char *buffer;	        // the actual char array
+	// strings up to SSO_CAPACITY characters are kept inline, without
+	// touching the heap; longer ones move to a heap buffer and stay there
+	enum { SSO_CAPACITY = 15 };
+
+	char *buffer;	        // the actual char array, inline or on the heap
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
 	unsigned char flags;    // unused, for future features
+	char inline_buffer[SSO_CAPACITY + 1];
 protected:
 	void init(void);
+	inline bool isInline(void) const {return buffer == inline_buffer;}
+	void releaseBuffer(void);
 	void invalidate(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
 	unsigned char concat(const char *cstr, unsigned int length);